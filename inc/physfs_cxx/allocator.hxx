@@ -0,0 +1,668 @@
+#ifndef PHYSFS_CXX_ALLOCATOR_HXX
+#define PHYSFS_CXX_ALLOCATOR_HXX
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "error.hxx"
+
+namespace physfs
+{
+  /// number of size classes used for the statistics and by the pool_allocator (16 bytes up to 4 KiB and larger blocks)
+  static const std::size_t size_class_count = 10;
+
+  struct allocator_stats
+  {
+    std::uint64_t live_bytes;
+    std::uint64_t peak_bytes;
+    std::uint64_t allocations;
+    std::uint64_t deallocations;
+    /// allocations per size class, class i holds blocks up to size_class_limit(i) bytes
+    std::array<std::uint64_t, size_class_count> class_allocations;
+  };
+
+  /// largest request (in bytes) of size class \p index, the last class is unbounded
+  inline std::size_t size_class_limit(std::size_t index) noexcept
+  {
+    return (index + 1 < size_class_count) ? (std::size_t(16) << index) : std::numeric_limits<std::size_t>::max();
+  }
+
+  inline std::size_t size_class(std::size_t size) noexcept
+  {
+    std::size_t index = 0;
+    while (index + 1 < size_class_count && size > size_class_limit(index))
+    {
+      ++index;
+    }
+    return index;
+  }
+
+  /// Memory source for physfs, installed with set_allocator() before init().
+  ///
+  /// The statistics are kept by the facade which calls the allocator, they count the bytes requested by physfs.
+  /// An allocator has to stay alive until physfs is deinitialized.
+  class allocator
+  {
+  public:
+    allocator() noexcept : m_live_bytes(0), m_peak_bytes(0), m_allocations(0), m_deallocations(0), m_class_allocations()
+    {
+      for (auto& counter : m_class_allocations)
+      {
+        counter.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    allocator(const allocator&) = delete;
+    allocator& operator=(const allocator&) = delete;
+
+    virtual ~allocator() = default;
+
+    /// returns a block of at least \p size bytes aligned for every fundamental type or nullptr
+    virtual void* allocate(std::size_t size) = 0;
+    virtual void deallocate(void* block, std::size_t size) noexcept = 0;
+
+    virtual void* reallocate(void* block, std::size_t old_size, std::size_t new_size)
+    {
+      void* resized = allocate(new_size);
+      if (resized != nullptr)
+      {
+        std::memcpy(resized, block, std::min(old_size, new_size));
+        deallocate(block, old_size);
+      }
+      return resized;
+    }
+
+    /// the allocator which owns the blocks handed out for this allocator
+    virtual allocator& resource() noexcept { return *this; }
+
+    virtual allocator_stats stats() const noexcept
+    {
+      allocator_stats values{};
+      values.live_bytes = m_live_bytes.load(std::memory_order_relaxed);
+      values.peak_bytes = m_peak_bytes.load(std::memory_order_relaxed);
+      values.allocations = m_allocations.load(std::memory_order_relaxed);
+      values.deallocations = m_deallocations.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < size_class_count; ++i)
+      {
+        values.class_allocations[i] = m_class_allocations[i].load(std::memory_order_relaxed);
+      }
+      return values;
+    }
+
+    inline void record_allocation(std::size_t size) noexcept
+    {
+      const auto live = m_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+      auto peak = m_peak_bytes.load(std::memory_order_relaxed);
+      while (live > peak && !m_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      {
+      }
+      m_allocations.fetch_add(1, std::memory_order_relaxed);
+      m_class_allocations[size_class(size)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void record_deallocation(std::size_t size) noexcept
+    {
+      m_live_bytes.fetch_sub(size, std::memory_order_relaxed);
+      m_deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<std::uint64_t> m_live_bytes;
+    std::atomic<std::uint64_t> m_peak_bytes;
+    std::atomic<std::uint64_t> m_allocations;
+    std::atomic<std::uint64_t> m_deallocations;
+    std::array<std::atomic<std::uint64_t>, size_class_count> m_class_allocations;
+  };
+
+  /// forwards to malloc/realloc/free, the reference for the other allocators
+  class system_allocator : public allocator
+  {
+  public:
+    void* allocate(std::size_t size) override { return std::malloc(size); }
+    void deallocate(void* block, std::size_t) noexcept override { std::free(block); }
+    void* reallocate(void* block, std::size_t, std::size_t new_size) override { return std::realloc(block, new_size); }
+  };
+
+  /// Size class pool with a cache of free blocks per thread.
+  ///
+  /// Blocks up to 4 KiB are carved from 64 KiB slabs and recycled through per class free lists, larger blocks
+  /// come from malloc. Each thread keeps a few free blocks per class for the pool it used last, so most
+  /// allocations and deallocations don't touch a lock. Slabs are only returned to the system by the destructor.
+  class pool_allocator : public allocator
+  {
+    static const std::size_t pooled_classes = size_class_count - 1;
+    static const std::size_t slab_size = 64 * 1024;
+
+  public:
+    pool_allocator() : m_id(next_id()), m_classes()
+    {
+      std::lock_guard<std::mutex> lock(registry_mutex());
+      live_pools().emplace(m_id, this);
+    }
+
+    ~pool_allocator() override
+    {
+      {
+        // caches of other threads which still point to this pool are dropped instead of flushed
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        live_pools().erase(m_id);
+      }
+      thread_cache& cache = local_cache();
+      if (cache.owner == m_id)
+      {
+        cache.clear();
+      }
+      for (auto& pool_class : m_classes)
+      {
+        for (void* slab : pool_class.slabs)
+        {
+          std::free(slab);
+        }
+      }
+    }
+
+    void* allocate(std::size_t size) override
+    {
+      const std::size_t index = size_class(size);
+      if (index >= pooled_classes)
+      {
+        return std::malloc(size);
+      }
+
+      thread_cache& cache = adopt_cache();
+      if (cache.blocks[index] == nullptr)
+      {
+        refill(cache, index);
+        if (cache.blocks[index] == nullptr)
+        {
+          return nullptr;
+        }
+      }
+      return cache.pop(index);
+    }
+
+    void deallocate(void* block, std::size_t size) noexcept override
+    {
+      const std::size_t index = size_class(size);
+      if (index >= pooled_classes)
+      {
+        std::free(block);
+        return;
+      }
+
+      thread_cache& cache = adopt_cache();
+      cache.push(index, block);
+      if (cache.counts[index] > 2 * batch_size(index))
+      {
+        drain(cache, index, batch_size(index));
+      }
+    }
+
+    void* reallocate(void* block, std::size_t old_size, std::size_t new_size) override
+    {
+      const std::size_t old_index = size_class(old_size);
+      const std::size_t new_index = size_class(new_size);
+      if (old_index == new_index)
+      {
+        return (old_index >= pooled_classes) ? std::realloc(block, new_size) : block;
+      }
+      return allocator::reallocate(block, old_size, new_size);
+    }
+
+  private:
+    struct free_block
+    {
+      free_block* next;
+    };
+
+    struct pool_class
+    {
+      std::mutex mutex;
+      free_block* blocks = nullptr;
+      std::vector<void*> slabs;
+    };
+
+    struct thread_cache
+    {
+      std::uint64_t owner = 0;
+      std::array<free_block*, pooled_classes> blocks{};
+      std::array<std::size_t, pooled_classes> counts{};
+
+      ~thread_cache()
+      {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        const auto found = live_pools().find(owner);
+        if (found != live_pools().end())
+        {
+          found->second->flush(*this);
+        }
+      }
+
+      inline void* pop(std::size_t index) noexcept
+      {
+        free_block* block = blocks[index];
+        blocks[index] = block->next;
+        --counts[index];
+        return block;
+      }
+
+      inline void push(std::size_t index, void* block) noexcept
+      {
+        auto* entry = static_cast<free_block*>(block);
+        entry->next = blocks[index];
+        blocks[index] = entry;
+        ++counts[index];
+      }
+
+      inline void clear() noexcept
+      {
+        blocks.fill(nullptr);
+        counts.fill(0);
+      }
+    };
+
+    static inline std::size_t batch_size(std::size_t index) noexcept { return std::max<std::size_t>(4, 8192 / size_class_limit(index)); }
+
+    static inline std::uint64_t next_id() noexcept
+    {
+      static std::atomic<std::uint64_t> id(0);
+      return ++id;
+    }
+
+    static inline std::mutex& registry_mutex()
+    {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+    /// pools by id, a thread cache only flushes into a pool which is still registered
+    static inline std::map<std::uint64_t, pool_allocator*>& live_pools()
+    {
+      static std::map<std::uint64_t, pool_allocator*> pools;
+      return pools;
+    }
+
+    static inline thread_cache& local_cache()
+    {
+      static thread_local thread_cache cache;
+      return cache;
+    }
+
+    /// makes this pool the owner of the calling thread's cache, blocks cached for another pool go back to it
+    inline thread_cache& adopt_cache()
+    {
+      thread_cache& cache = local_cache();
+      if (cache.owner != m_id)
+      {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        const auto found = live_pools().find(cache.owner);
+        if (found != live_pools().end())
+        {
+          found->second->flush(cache);
+        }
+        cache.clear();
+        cache.owner = m_id;
+      }
+      return cache;
+    }
+
+    void flush(thread_cache& cache) noexcept
+    {
+      for (std::size_t index = 0; index < pooled_classes; ++index)
+      {
+        drain(cache, index, cache.counts[index]);
+      }
+    }
+
+    /// moves \p count blocks of class \p index from the thread cache to the shared free list
+    void drain(thread_cache& cache, std::size_t index, std::size_t count) noexcept
+    {
+      if (count == 0)
+      {
+        return;
+      }
+
+      free_block* first = cache.blocks[index];
+      free_block* last = first;
+      for (std::size_t i = 1; i < count; ++i)
+      {
+        last = last->next;
+      }
+      cache.blocks[index] = last->next;
+      cache.counts[index] -= count;
+
+      pool_class& shared = m_classes[index];
+      std::lock_guard<std::mutex> lock(shared.mutex);
+      last->next = shared.blocks;
+      shared.blocks = first;
+    }
+
+    void refill(thread_cache& cache, std::size_t index)
+    {
+      pool_class& shared = m_classes[index];
+      std::lock_guard<std::mutex> lock(shared.mutex);
+
+      if (shared.blocks == nullptr)
+      {
+        char* slab = static_cast<char*>(std::malloc(slab_size));
+        if (slab == nullptr)
+        {
+          return;
+        }
+        shared.slabs.push_back(slab);
+
+        const std::size_t block_size = size_class_limit(index);
+        for (std::size_t offset = 0; offset + block_size <= slab_size; offset += block_size)
+        {
+          auto* block = reinterpret_cast<free_block*>(slab + offset);
+          block->next = shared.blocks;
+          shared.blocks = block;
+        }
+      }
+
+      for (std::size_t i = 0; i < batch_size(index) && shared.blocks != nullptr; ++i)
+      {
+        free_block* block = shared.blocks;
+        shared.blocks = block->next;
+        cache.push(index, block);
+      }
+    }
+
+    std::uint64_t m_id;
+    std::array<pool_class, pooled_classes> m_classes;
+  };
+
+  namespace detail
+  {
+    /// Memory of an arena_allocator. It outlives the arena until the last block is released, blocks which
+    /// physfs keeps beyond the scope of the arena (e.g. the error state of a thread) stay valid.
+    class arena_resource : public allocator
+    {
+    public:
+      explicit arena_resource(std::size_t chunk_size) noexcept
+          : m_mutex(), m_chunks(), m_current(nullptr), m_remaining(0), m_last(nullptr), m_chunk_size(chunk_size), m_reserved(0), m_blocks(0), m_orphaned(false)
+      {
+      }
+
+      ~arena_resource() override
+      {
+        for (void* chunk : m_chunks)
+        {
+          std::free(chunk);
+        }
+      }
+
+      void* allocate(std::size_t size) override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size = align(size);
+        if (size > m_remaining)
+        {
+          const std::size_t chunk_size = std::max(m_chunk_size, size);
+          char* chunk = static_cast<char*>(std::malloc(chunk_size));
+          if (chunk == nullptr)
+          {
+            return nullptr;
+          }
+          m_chunks.push_back(chunk);
+          m_reserved += chunk_size;
+          m_current = chunk;
+          m_remaining = chunk_size;
+        }
+
+        m_last = m_current;
+        m_current += size;
+        m_remaining -= size;
+        ++m_blocks;
+        return m_last;
+      }
+
+      void deallocate(void*, std::size_t) noexcept override
+      {
+        // memory is only reclaimed by reset(), an orphaned arena goes away with its last block
+        bool last_block = false;
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          last_block = (--m_blocks == 0) && m_orphaned;
+        }
+        if (last_block)
+        {
+          delete this;
+        }
+      }
+
+      void* reallocate(void* block, std::size_t old_size, std::size_t new_size) override
+      {
+        {
+          // the latest block can grow and shrink in place
+          std::lock_guard<std::mutex> lock(m_mutex);
+          const std::size_t old_aligned = align(old_size);
+          const std::size_t new_aligned = align(new_size);
+          if (block == m_last && new_aligned <= old_aligned + m_remaining)
+          {
+            m_current = m_last + new_aligned;
+            m_remaining = m_remaining + old_aligned - new_aligned;
+            return block;
+          }
+        }
+        return allocator::reallocate(block, old_size, new_size);
+      }
+
+      inline std::size_t reserved_bytes() const
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reserved;
+      }
+
+      inline bool reset()
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_blocks != 0)
+        {
+          return false;
+        }
+        for (void* chunk : m_chunks)
+        {
+          std::free(chunk);
+        }
+        m_chunks.clear();
+        m_current = nullptr;
+        m_remaining = 0;
+        m_last = nullptr;
+        m_reserved = 0;
+        return true;
+      }
+
+      /// called by the owning arena, returns true if the resource can be deleted right away
+      inline bool orphan() noexcept
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_orphaned = true;
+        return m_blocks == 0;
+      }
+
+    private:
+      static inline std::size_t align(std::size_t size) noexcept { return (size + 15) & ~std::size_t(15); }
+
+      mutable std::mutex m_mutex;
+      std::vector<void*> m_chunks;
+      char* m_current;
+      std::size_t m_remaining;
+      char* m_last;
+      std::size_t m_chunk_size;
+      std::size_t m_reserved;
+      std::size_t m_blocks;
+      bool m_orphaned;
+    };
+  } // namespace detail
+
+  /// Bump allocator for scoped bulk operations like "mount, index, unmount" (see allocator_scope).
+  /// Freed blocks are not reused, the memory is returned by reset() or the destructor.
+  class arena_allocator : public allocator
+  {
+  public:
+    static const std::size_t default_chunk_size = 256 * 1024;
+
+    explicit arena_allocator(std::size_t chunk_size = default_chunk_size) : m_resource(new detail::arena_resource(chunk_size)) {}
+
+    ~arena_allocator() override
+    {
+      if (m_resource->orphan())
+      {
+        delete m_resource;
+      }
+    }
+
+    void* allocate(std::size_t size) override { return m_resource->allocate(size); }
+    void deallocate(void* block, std::size_t size) noexcept override { m_resource->deallocate(block, size); }
+    void* reallocate(void* block, std::size_t old_size, std::size_t new_size) override { return m_resource->reallocate(block, old_size, new_size); }
+
+    allocator& resource() noexcept override { return *m_resource; }
+    allocator_stats stats() const noexcept override { return m_resource->stats(); }
+
+    /// bytes taken from the system
+    inline std::size_t reserved_bytes() const { return m_resource->reserved_bytes(); }
+    /// releases all chunks, fails (returns false) while blocks are alive
+    inline bool reset() { return m_resource->reset(); }
+
+  private:
+    detail::arena_resource* m_resource;
+  };
+
+  namespace detail
+  {
+    /// every block starts with the allocator which owns it and the requested size
+    struct allocation_header
+    {
+      allocator* owner;
+      std::uint64_t size;
+    };
+    static const std::size_t allocation_header_size = 16;
+    static_assert(sizeof(allocation_header) <= allocation_header_size, "allocation header too large");
+
+    inline std::atomic<allocator*>& installed_allocator() noexcept
+    {
+      static std::atomic<allocator*> installed(nullptr);
+      return installed;
+    }
+
+    inline allocator*& scoped_allocator() noexcept
+    {
+      static thread_local allocator* scoped = nullptr;
+      return scoped;
+    }
+
+    inline int facade_init() { return 1; }
+    inline void facade_deinit() {}
+
+    inline void* facade_malloc(PHYSFS_uint64 size)
+    {
+      allocator* current = scoped_allocator();
+      if (current == nullptr)
+      {
+        current = installed_allocator().load();
+      }
+      if (current == nullptr || size > std::numeric_limits<std::size_t>::max() - allocation_header_size)
+      {
+        return nullptr;
+      }
+
+      allocator& owner = current->resource();
+      auto* header = static_cast<allocation_header*>(owner.allocate(static_cast<std::size_t>(size) + allocation_header_size));
+      if (header == nullptr)
+      {
+        return nullptr;
+      }
+      header->owner = &owner;
+      header->size = size;
+      owner.record_allocation(static_cast<std::size_t>(size));
+      return reinterpret_cast<char*>(header) + allocation_header_size;
+    }
+
+    inline void facade_free(void* block)
+    {
+      if (block != nullptr)
+      {
+        auto* header = reinterpret_cast<allocation_header*>(static_cast<char*>(block) - allocation_header_size);
+        allocator* owner = header->owner;
+        const auto size = static_cast<std::size_t>(header->size);
+        owner->record_deallocation(size);
+        owner->deallocate(header, size + allocation_header_size);
+      }
+    }
+
+    inline void* facade_realloc(void* block, PHYSFS_uint64 size)
+    {
+      if (block == nullptr)
+      {
+        return facade_malloc(size);
+      }
+      if (size > std::numeric_limits<std::size_t>::max() - allocation_header_size)
+      {
+        return nullptr;
+      }
+
+      auto* header = reinterpret_cast<allocation_header*>(static_cast<char*>(block) - allocation_header_size);
+      allocator* owner = header->owner;
+      const auto old_size = static_cast<std::size_t>(header->size);
+      auto* resized = static_cast<allocation_header*>(
+          owner->reallocate(header, old_size + allocation_header_size, static_cast<std::size_t>(size) + allocation_header_size));
+      if (resized == nullptr)
+      {
+        return nullptr;
+      }
+      resized->size = size;
+      owner->record_deallocation(old_size);
+      owner->record_allocation(static_cast<std::size_t>(size));
+      return reinterpret_cast<char*>(resized) + allocation_header_size;
+    }
+  } // namespace detail
+
+  /// Installs \p backend for all allocations of physfs, has to be called before init(). nullptr restores the default allocator.
+  inline void set_allocator(allocator* backend)
+  {
+    static const PHYSFS_Allocator facade = {
+        &detail::facade_init, &detail::facade_deinit, &detail::facade_malloc, &detail::facade_realloc, &detail::facade_free};
+
+    PHYSFS_CXX_CHECK(PHYSFS_setAllocator((backend != nullptr) ? &facade : nullptr) != 0);
+    detail::installed_allocator().store(backend);
+  }
+
+  inline allocator* get_allocator() noexcept { return detail::installed_allocator().load(); }
+
+  /// Routes the allocations of physfs on the calling thread to \p backend while the scope is alive.
+  /// Needs an allocator installed with set_allocator(), blocks are always returned to the allocator they came from.
+  class allocator_scope
+  {
+  public:
+    explicit allocator_scope(allocator& backend) : m_previous(detail::scoped_allocator())
+    {
+      if (get_allocator() == nullptr)
+      {
+        throw exception("PHYSFS ERROR: allocator scopes need an allocator installed with set_allocator()");
+      }
+      detail::scoped_allocator() = &backend;
+    }
+
+    allocator_scope(const allocator_scope&) = delete;
+    allocator_scope& operator=(const allocator_scope&) = delete;
+
+    ~allocator_scope() noexcept { detail::scoped_allocator() = m_previous; }
+
+  private:
+    allocator* m_previous;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_ALLOCATOR_HXX*/
@@ -0,0 +1,50 @@
+#ifndef PHYSFS_CXX_BLOB_HXX
+#define PHYSFS_CXX_BLOB_HXX
+
+#include <cstdint>
+#include <memory>
+
+namespace physfs
+{
+  /// Immutable, reference counted block of bytes. Copies share the same storage.
+  class blob
+  {
+  public:
+    typedef const char* const_iterator;
+
+    blob() noexcept : m_data(), m_size(0) {}
+    /// Takes shared ownership of \p data, a custom deleter allows to wrap foreign memory (e.g. a mmaped file).
+    blob(std::shared_ptr<const char> data, std::size_t size) noexcept : m_data(std::move(data)), m_size(size) {}
+
+    /// Allocates uninitialized storage of \p size bytes which can be filled through \p storage once.
+    static inline blob allocate(std::size_t size, char*& storage)
+    {
+      storage = new char[size];
+      return blob(std::shared_ptr<const char>(storage, std::default_delete<const char[]>()), size);
+    }
+
+    inline const char* data() const noexcept { return m_data.get(); }
+    inline std::size_t size() const noexcept { return m_size; }
+    inline bool empty() const noexcept { return m_size == 0; }
+
+    inline const_iterator begin() const noexcept { return data(); }
+    inline const_iterator end() const noexcept { return data() + m_size; }
+
+    inline long use_count() const noexcept { return m_data.use_count(); }
+
+    /// Returns a view on \p size bytes starting at \p offset which shares the storage of this blob.
+    inline blob slice(std::size_t offset, std::size_t size) const noexcept
+    {
+      offset = (offset < m_size) ? offset : m_size;
+      size = (size < m_size - offset) ? size : m_size - offset;
+      return blob(std::shared_ptr<const char>(m_data, m_data.get() + offset), size);
+    }
+
+  private:
+    std::shared_ptr<const char> m_data;
+    std::size_t m_size;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_BLOB_HXX*/
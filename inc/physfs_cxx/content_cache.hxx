@@ -0,0 +1,222 @@
+#ifndef PHYSFS_CXX_CONTENT_CACHE_HXX
+#define PHYSFS_CXX_CONTENT_CACHE_HXX
+
+#include <physfs.h>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "blob.hxx"
+#include "core.hxx"
+#include "file_device.hxx"
+
+namespace physfs
+{
+  struct content_cache_stats
+  {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    /// entries dropped to stay below the capacity
+    std::uint64_t evictions;
+    /// entries dropped because their search path entry was unmounted, remounted or shadowed
+    std::uint64_t invalidations;
+    std::size_t entries;
+    std::size_t bytes;
+    std::size_t capacity;
+  };
+
+  /// Thread safe cache of whole (decompressed) files by virtual path, the least recently used files are dropped to
+  /// keep the cached bytes below the capacity. Hits share the cached blob without copying it.
+  ///
+  /// Entries are validated against mount_generation(): after a mount or unmount an entry is only kept if its file
+  /// still comes from the same, not remounted search path entry. Files changed through the write dir are not
+  /// noticed, erase() them after writing.
+  ///
+  /// \code
+  /// physfs::content_cache cache(16 * 1024 * 1024);
+  /// physfs::ifstream shader("shaders/basic.glsl", cache.get("shaders/basic.glsl"));
+  /// \endcode
+  class content_cache
+  {
+  public:
+    static const std::size_t default_capacity = 64 * 1024 * 1024;
+
+    explicit content_cache(std::size_t capacity = default_capacity)
+        : m_mutex(), m_entries(), m_order(), m_bytes(0), m_capacity(capacity), m_hits(0), m_misses(0), m_evictions(0), m_invalidations(0)
+    {
+    }
+
+    content_cache(const content_cache&) = delete;
+    content_cache& operator=(const content_cache&) = delete;
+
+    /// The content of \p filename, read with read_all_shared() on a miss. Files larger than the capacity are
+    /// returned without being cached. Throws like read_all_shared() if the file can't be read.
+    blob get(const std::string& filename)
+    {
+      const std::uint64_t generation = mount_generation();
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_entries.find(filename);
+        if (found != m_entries.end())
+        {
+          entry& cached = found->second;
+          if (cached.generation == generation || is_current(filename, cached))
+          {
+            cached.generation = generation;
+            m_order.splice(m_order.begin(), m_order, cached.position);
+            ++m_hits;
+            return cached.content;
+          }
+          ++m_invalidations;
+          drop(found);
+        }
+        ++m_misses;
+      }
+
+      // the source is looked up before the read and the content is only cached if no mount changed meanwhile,
+      // otherwise the entry could record a search path entry which didn't provide the content
+      const char* source = PHYSFS_getRealDir(filename.c_str());
+      const std::string real_dir(source != nullptr ? source : "");
+      const std::uint64_t mounted_at = detail::mount_table::instance().mounted_at(real_dir);
+
+      // read without the lock, other threads keep hitting meanwhile
+      blob content = read_all_shared(filename);
+      if (source != nullptr && mount_generation() == generation)
+      {
+        insert(filename, content, generation, real_dir, mounted_at);
+      }
+      return content;
+    }
+
+    /// drops \p filename, e.g. after it was written
+    void erase(const std::string& filename)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto found = m_entries.find(filename);
+      if (found != m_entries.end())
+      {
+        drop(found);
+      }
+    }
+
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_entries.clear();
+      m_order.clear();
+      m_bytes = 0;
+    }
+
+    /// changes the capacity in bytes, the least recently used entries are dropped right away if needed
+    void set_capacity(std::size_t capacity)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_capacity = capacity;
+      evict(0);
+    }
+
+    inline std::size_t capacity() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_capacity;
+    }
+
+    content_cache_stats stats() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return content_cache_stats{m_hits, m_misses, m_evictions, m_invalidations, m_entries.size(), m_bytes, m_capacity};
+    }
+
+    /// clears the counters, the cached entries stay
+    void reset_stats()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_hits = 0;
+      m_misses = 0;
+      m_evictions = 0;
+      m_invalidations = 0;
+    }
+
+  private:
+    struct entry
+    {
+      blob content;
+      /// mount generation at which the entry was last known to be current
+      std::uint64_t generation;
+      /// search path entry which provided the content and the generation it was mounted at
+      std::string real_dir;
+      std::uint64_t mounted_at;
+      std::list<std::string>::iterator position;
+    };
+    using entry_map = std::unordered_map<std::string, entry>;
+
+    /// the file is still served by the same mount
+    static bool is_current(const std::string& filename, const entry& cached)
+    {
+      const char* real_dir = PHYSFS_getRealDir(filename.c_str());
+      return real_dir != nullptr && cached.real_dir == real_dir && detail::mount_table::instance().mounted_at(cached.real_dir) == cached.mounted_at;
+    }
+
+    void insert(const std::string& filename, const blob& content, std::uint64_t generation, const std::string& real_dir, std::uint64_t mounted_at)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (content.size() > m_capacity)
+      {
+        return;
+      }
+
+      auto found = m_entries.find(filename);
+      if (found != m_entries.end())
+      {
+        drop(found);
+      }
+      evict(content.size());
+
+      m_order.push_front(filename);
+      try
+      {
+        m_entries.emplace(filename, entry{content, generation, real_dir, mounted_at, m_order.begin()});
+      }
+      catch (...)
+      {
+        m_order.pop_front();
+        throw;
+      }
+      m_bytes += content.size();
+    }
+
+    /// drops the least recently used entries until \p reserve more bytes fit
+    void evict(std::size_t reserve)
+    {
+      while (!m_order.empty() && m_bytes + reserve > m_capacity)
+      {
+        drop(m_entries.find(m_order.back()));
+        ++m_evictions;
+      }
+    }
+
+    void drop(entry_map::iterator found)
+    {
+      m_bytes -= found->second.content.size();
+      m_order.erase(found->second.position);
+      m_entries.erase(found);
+    }
+
+    mutable std::mutex m_mutex;
+    entry_map m_entries;
+    /// most recently used first
+    std::list<std::string> m_order;
+    std::size_t m_bytes;
+    std::size_t m_capacity;
+    std::uint64_t m_hits;
+    std::uint64_t m_misses;
+    std::uint64_t m_evictions;
+    std::uint64_t m_invalidations;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_CONTENT_CACHE_HXX*/
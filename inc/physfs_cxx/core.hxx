@@ -3,11 +3,18 @@
 
 #include <physfs.h>
 
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "allocator.hxx"
+#include "blob.hxx"
 #include "error.hxx"
+#include "instrumentation.hxx"
 
 namespace physfs
 {
@@ -50,14 +57,29 @@ namespace physfs
   inline void init(const char* executable_name = nullptr) { PHYSFS_CXX_CHECK(PHYSFS_init(executable_name) != 0); }
   inline void init(const std::string& executable_name) { init(executable_name.c_str()); }
 
+  /// initializes physfs with \p backend for all its allocations, \p backend has to outlive deinit()
+  inline void init(const char* executable_name, allocator& backend)
+  {
+    set_allocator(&backend);
+    if (PHYSFS_init(executable_name) == 0)
+    {
+      exception error;
+      set_allocator(nullptr);
+      throw error;
+    }
+  }
+  inline void init(const std::string& executable_name, allocator& backend) { init(executable_name.c_str(), backend); }
+
   inline void deinit() { PHYSFS_CXX_CHECK(PHYSFS_deinit() != 0); }
   inline bool is_init() noexcept { return (PHYSFS_isInit() != 0); }
 
   struct init_guard
   {
     init_guard() : init_guard(nullptr) {}
-    explicit init_guard(const char* argv0) { init(argv0); }
-    explicit init_guard(const std::string& argv0) { init(argv0); }
+    explicit init_guard(const char* argv0) : m_custom_allocator(false) { init(argv0); }
+    explicit init_guard(const std::string& argv0) : m_custom_allocator(false) { init(argv0); }
+    init_guard(const char* argv0, allocator& backend) : m_custom_allocator(true) { init(argv0, backend); }
+    init_guard(const std::string& argv0, allocator& backend) : m_custom_allocator(true) { init(argv0, backend); }
 
     init_guard(init_guard&&) noexcept = default;
     init_guard& operator=(init_guard&&) noexcept = default;
@@ -67,6 +89,10 @@ namespace physfs
       try
       {
         deinit();
+        if (m_custom_allocator)
+        {
+          set_allocator(nullptr);
+        }
       }
       catch (exception& e)
       {
@@ -77,6 +103,9 @@ namespace physfs
         std::cerr << __FUNCTION__ << " Couldn't deinit physfs! unexpected exception!" << std::endl;
       }
     }
+
+  private:
+    bool m_custom_allocator;
   };
 
   inline void permit_symbolic_links(bool allow) noexcept { PHYSFS_permitSymbolicLinks((allow ? 1 : 0)); }
@@ -110,6 +139,94 @@ namespace physfs
     return std::string(dir_name);
   }
 
+  namespace detail
+  {
+    inline std::atomic<std::uint64_t>& vfs_generation_counter() noexcept
+    {
+      static std::atomic<std::uint64_t> counter(0);
+      return counter;
+    }
+
+    /// marks a (possible) change of the virtual file tree and passes \p result through
+    inline int vfs_modified(int result) noexcept
+    {
+      ++vfs_generation_counter();
+      return result;
+    }
+  } // namespace detail
+
+  /// Changes whenever the virtual file tree may have been modified through this wrapper (mounting, unmounting,
+  /// changing the write dir, creating or removing files and directories). Caches use it to detect stale entries.
+  inline std::uint64_t vfs_generation() noexcept { return detail::vfs_generation_counter().load(); }
+
+  namespace detail
+  {
+    /// search path entries mounted through this wrapper and the mount generation they were mounted at
+    class mount_table
+    {
+    public:
+      static inline mount_table& instance()
+      {
+        static mount_table table;
+        return table;
+      }
+
+      inline void add(const std::string& name)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_mounted[name] = ++m_generation;
+      }
+
+      inline void remove(const std::string& name)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_mounted.erase(name);
+        ++m_generation;
+      }
+
+      inline std::uint64_t generation() const noexcept { return m_generation.load(); }
+
+      /// 0 for entries which weren't mounted through this wrapper
+      inline std::uint64_t mounted_at(const std::string& name) const
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_mounted.find(name);
+        return (found != m_mounted.end()) ? found->second : 0;
+      }
+
+    private:
+      mount_table() : m_mutex(), m_generation(0), m_mounted() {}
+
+      mutable std::mutex m_mutex;
+      std::atomic<std::uint64_t> m_generation;
+      std::map<std::string, std::uint64_t> m_mounted;
+    };
+
+    /// records a successful mount of \p name and passes \p result through
+    inline int mounted(const std::string& name, int result)
+    {
+      if (result != 0)
+      {
+        mount_table::instance().add(name);
+      }
+      return vfs_modified(result);
+    }
+
+    /// records a successful unmount of \p name and passes \p result through
+    inline int unmounted(const std::string& name, int result)
+    {
+      if (result != 0)
+      {
+        mount_table::instance().remove(name);
+      }
+      return vfs_modified(result);
+    }
+  } // namespace detail
+
+  /// Changes whenever a search path entry is mounted or unmounted through this wrapper. Unlike vfs_generation() it
+  /// stays the same while files are written, so caches of file contents use it.
+  inline std::uint64_t mount_generation() noexcept { return detail::mount_table::instance().generation(); }
+
   namespace detail
   {
     inline file_list convert_to_vector(char** list)
@@ -126,15 +243,66 @@ namespace physfs
   } // namespace detail
 
   inline file_list get_search_paths() { return detail::convert_to_vector(PHYSFS_getSearchPath()); }
-  inline file_list enumerate_files(const std::string& dir) { return detail::convert_to_vector(PHYSFS_enumerateFiles(dir.c_str())); }
+  inline file_list enumerate_files(const std::string& dir)
+  {
+    detail::io_probe probe(io_operation::enumerate, dir);
+    file_list files = detail::convert_to_vector(PHYSFS_enumerateFiles(dir.c_str()));
+    probe.done();
+    return files;
+  }
+
+  namespace detail
+  {
+    template <typename Callback>
+    struct enumerate_context
+    {
+      Callback& callback;
+      std::exception_ptr error;
+    };
+
+    template <typename Callback>
+    PHYSFS_EnumerateCallbackResult enumerate_callback(void* data, const char*, const char* name)
+    {
+      auto* context = static_cast<enumerate_context<Callback>*>(data);
+      try
+      {
+        return context->callback(name) ? PHYSFS_ENUM_OK : PHYSFS_ENUM_STOP;
+      }
+      catch (...)
+      {
+        // exceptions must not pass through physfs
+        context->error = std::current_exception();
+        return PHYSFS_ENUM_ERROR;
+      }
+    }
+  } // namespace detail
+
+  /// Calls \p callback with the name (as const char*) of every entry in \p dir without building a list.
+  /// The callback returns false to stop the enumeration. Unlike enumerate_files() a name which exists in
+  /// several search paths is reported once per search path.
+  template <typename Callback>
+  inline void enumerate(const std::string& dir, Callback callback)
+  {
+    detail::io_probe probe(io_operation::enumerate, dir);
+    detail::enumerate_context<Callback> context{callback, nullptr};
+    const int result = PHYSFS_enumerate(dir.c_str(), &detail::enumerate_callback<Callback>, &context);
+    if (context.error)
+    {
+      std::rethrow_exception(context.error);
+    }
+    PHYSFS_CXX_CHECK(result != 0);
+    probe.done();
+  }
 
   inline bool exists(const std::string& filename) noexcept { return (PHYSFS_exists(filename.c_str()) != 0); }
-  inline void remove(const std::string& filename) { PHYSFS_CXX_CHECK(PHYSFS_delete(filename.c_str()) != 0); }
+  inline void remove(const std::string& filename) { PHYSFS_CXX_CHECK(detail::vfs_modified(PHYSFS_delete(filename.c_str())) != 0); }
 
   inline file_stat get_file_stat(const std::string& filename)
   {
+    detail::io_probe probe(io_operation::stat, filename);
     PHYSFS_Stat stat;
     PHYSFS_CXX_CHECK(PHYSFS_stat(filename.c_str(), &stat) != 0);
+    probe.done();
     return file_stat(stat);
   }
 
@@ -145,19 +313,268 @@ namespace physfs
   inline bool is_symlink(const std::string& filename) { return get_file_stat(filename).type() == filetype::symlink; }
   inline bool is_directory(const std::string& filename) { return get_file_stat(filename).type() == filetype::directory; }
 
-  inline void make_directory(const std::string& path) { PHYSFS_CXX_CHECK(PHYSFS_mkdir(path.c_str()) != 0); }
+  inline void make_directory(const std::string& path) { PHYSFS_CXX_CHECK(detail::vfs_modified(PHYSFS_mkdir(path.c_str())) != 0); }
 
-  inline void mount(const std::string& target, bool append = true) { PHYSFS_CXX_CHECK(PHYSFS_mount(target.c_str(), nullptr, (append ? 1 : 0)) != 0); }
+  namespace detail
+  {
+    /// native path which mount() is mounting on this thread, nullptr outside of mount()
+    inline const std::string*& native_mount() noexcept
+    {
+      static thread_local const std::string* path = nullptr;
+      return path;
+    }
+
+    /// Marks \p path as the native file behind the archive mounted on this thread for the lifetime of the scope.
+    class native_mount_scope
+    {
+    public:
+      explicit native_mount_scope(const std::string& path) noexcept : m_previous(native_mount()) { native_mount() = &path; }
+      ~native_mount_scope() noexcept { native_mount() = m_previous; }
+
+      native_mount_scope(const native_mount_scope&) = delete;
+      native_mount_scope& operator=(const native_mount_scope&) = delete;
+
+    private:
+      const std::string* m_previous;
+    };
+
+    /// True if an archiver may open \p name as the native file behind its io. Archives mounted from memory, handles or
+    /// custom ios pass arbitrary names, which may match an unrelated file on disk.
+    inline bool is_native_mount(const char* name) noexcept
+    {
+      const std::string* path = native_mount();
+      return path != nullptr && name != nullptr && *path == name;
+    }
+  } // namespace detail
+
+  inline void mount(const std::string& target, bool append = true)
+  {
+    detail::io_probe probe(io_operation::mount, target);
+    detail::native_mount_scope native(target);
+    PHYSFS_CXX_CHECK(detail::mounted(target, PHYSFS_mount(target.c_str(), nullptr, (append ? 1 : 0))) != 0);
+    probe.done();
+  }
   inline void mount(const std::string& target, const std::string& mount_point, bool append = true)
   {
-    PHYSFS_CXX_CHECK(PHYSFS_mount(target.c_str(), mount_point.c_str(), (append ? 1 : 0)) != 0);
+    detail::io_probe probe(io_operation::mount, target);
+    detail::native_mount_scope native(target);
+    PHYSFS_CXX_CHECK(detail::mounted(target, PHYSFS_mount(target.c_str(), mount_point.c_str(), (append ? 1 : 0))) != 0);
+    probe.done();
   }
 
-  inline void unmount(const std::string& target) { PHYSFS_CXX_CHECK(PHYSFS_unmount(target.c_str()) != 0); }
+  inline void unmount(const std::string& target)
+  {
+    detail::io_probe probe(io_operation::unmount, target);
+    PHYSFS_CXX_CHECK(detail::unmounted(target, PHYSFS_unmount(target.c_str())) != 0);
+    probe.done();
+  }
+
+  /// Unmounts the search path entry \p name on destruction.
+  class mount_guard
+  {
+  public:
+    mount_guard() noexcept : m_name() {}
+    /// adopts an already mounted search path entry
+    explicit mount_guard(std::string name) noexcept : m_name(std::move(name)) {}
+
+    mount_guard(const mount_guard&) = delete;
+    mount_guard& operator=(const mount_guard&) = delete;
+
+    mount_guard(mount_guard&& other) noexcept : m_name(other.release()) {}
+    mount_guard& operator=(mount_guard&& other) noexcept
+    {
+      if (this != &other)
+      {
+        reset();
+        m_name = other.release();
+      }
+      return *this;
+    }
+
+    ~mount_guard() noexcept { reset(); }
+
+    inline const std::string& name() const noexcept { return m_name; }
+    inline bool is_mounted() const noexcept { return !m_name.empty(); }
+
+    inline void unmount()
+    {
+      if (is_mounted())
+      {
+        physfs::unmount(m_name);
+        m_name.clear();
+      }
+    }
+
+    /// gives up the ownership, the entry stays mounted
+    inline std::string release() noexcept
+    {
+      std::string name;
+      name.swap(m_name);
+      return name;
+    }
+
+  private:
+    inline void reset() noexcept
+    {
+      try
+      {
+        unmount();
+      }
+      catch (exception& e)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't unmount \"" << m_name << "\"! : " << e.what() << std::endl;
+      }
+      catch (...)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't unmount \"" << m_name << "\"! unexpected exception!" << std::endl;
+      }
+    }
+
+    std::string m_name;
+  };
+
+  namespace detail
+  {
+    /// keeps blobs alive until physfs releases the memory archive which uses them
+    class memory_mount_registry
+    {
+    public:
+      inline void add(const blob& data)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_blobs.insert(std::make_pair(static_cast<const void*>(data.data()), data));
+      }
+
+      inline void remove(const void* buffer) noexcept
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_blobs.find(buffer);
+        if (found != m_blobs.end())
+        {
+          m_blobs.erase(found);
+        }
+      }
+
+      static inline memory_mount_registry& instance()
+      {
+        static memory_mount_registry registry;
+        return registry;
+      }
+
+      static inline void release(void* buffer) { instance().remove(buffer); }
+
+    private:
+      std::mutex m_mutex;
+      std::multimap<const void*, blob> m_blobs;
+    };
+  } // namespace detail
+
+  /// Mounts an archive held in memory without copying it. The caller has to keep \p buffer alive while it is mounted.
+  /// \p name identifies the search path entry and its extension (e.g. ".zip") selects the archiver.
+  inline mount_guard mount_memory(const void* buffer, std::uint64_t length, const std::string& name, const std::string& mount_point, bool append = true)
+  {
+    detail::io_probe probe(io_operation::mount, name);
+    PHYSFS_CXX_CHECK(detail::mounted(name, PHYSFS_mountMemory(buffer, length, nullptr, name.c_str(), mount_point.c_str(), (append ? 1 : 0))) != 0);
+    probe.done(length);
+    return mount_guard(name);
+  }
+
+  /// Mounts an archive held in memory without copying it. \p data stays alive until physfs closes the archive.
+  inline mount_guard mount_memory(const blob& data, const std::string& name, const std::string& mount_point, bool append = true)
+  {
+    detail::io_probe probe(io_operation::mount, name);
+    auto& registry = detail::memory_mount_registry::instance();
+    registry.add(data);
+    const int result =
+        PHYSFS_mountMemory(data.data(), data.size(), &detail::memory_mount_registry::release, name.c_str(), mount_point.c_str(), (append ? 1 : 0));
+    if (detail::mounted(name, result) == 0)
+    {
+      // physfs doesn't call the release function if the mount fails
+      registry.remove(data.data());
+      throw exception();
+    }
+    probe.done(data.size());
+    return mount_guard(name);
+  }
+
+  /// Deregisters an archiver on destruction. physfs drops all archivers on deinit, so a guard which outlives the
+  /// library does nothing.
+  class archiver_guard
+  {
+  public:
+    archiver_guard() noexcept : m_extension() {}
+    /// adopts the archiver registered for \p extension
+    explicit archiver_guard(std::string extension) noexcept : m_extension(std::move(extension)) {}
+
+    archiver_guard(const archiver_guard&) = delete;
+    archiver_guard& operator=(const archiver_guard&) = delete;
+
+    archiver_guard(archiver_guard&& other) noexcept : m_extension(other.release()) {}
+    archiver_guard& operator=(archiver_guard&& other) noexcept
+    {
+      if (this != &other)
+      {
+        reset();
+        m_extension = other.release();
+      }
+      return *this;
+    }
+
+    ~archiver_guard() noexcept { reset(); }
+
+    inline const std::string& extension() const noexcept { return m_extension; }
+    inline bool is_registered() const noexcept { return !m_extension.empty(); }
+
+    inline void deregister()
+    {
+      if (is_registered() && is_init())
+      {
+        PHYSFS_CXX_CHECK(PHYSFS_deregisterArchiver(m_extension.c_str()) != 0);
+      }
+      m_extension.clear();
+    }
+
+    /// gives up the ownership, the archiver stays registered
+    inline std::string release() noexcept
+    {
+      std::string extension;
+      extension.swap(m_extension);
+      return extension;
+    }
+
+  private:
+    inline void reset() noexcept
+    {
+      try
+      {
+        deregister();
+      }
+      catch (exception& e)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't deregister the archiver for \"" << m_extension << "\"! : " << e.what() << std::endl;
+        m_extension.clear();
+      }
+      catch (...)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't deregister the archiver for \"" << m_extension << "\"! unexpected exception!" << std::endl;
+        m_extension.clear();
+      }
+    }
+
+    std::string m_extension;
+  };
+
+  /// Registers \p archiver for its extension, physfs copies the description. Archives of the type can't be mounted
+  /// any more when the guard deregisters it.
+  inline archiver_guard register_archiver(const PHYSFS_Archiver& archiver)
+  {
+    PHYSFS_CXX_CHECK(PHYSFS_registerArchiver(&archiver) != 0);
+    return archiver_guard(archiver.info.extension);
+  }
 
   namespace detail
   {
-    inline void set_write_dir(const char* write_dir) { PHYSFS_CXX_CHECK(PHYSFS_setWriteDir(write_dir) != 0); }
+    inline void set_write_dir(const char* write_dir) { PHYSFS_CXX_CHECK(detail::vfs_modified(PHYSFS_setWriteDir(write_dir)) != 0); }
   } // namespace detail
 
   inline void disable_writing() { detail::set_write_dir(nullptr); }
@@ -4,7 +4,16 @@
 #include <iostream>
 #include <physfs.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "blob.hxx"
+#include "core.hxx"
 #include "error.hxx"
+#include "instrumentation.hxx"
 
 namespace physfs
 {
@@ -18,14 +27,54 @@ namespace physfs
   struct file_device
   {
   public:
-    explicit file_device() noexcept : m_file(nullptr), m_filename(){};
-    file_device(const std::string& file_path, access_mode mode) : m_file(nullptr), m_filename() { open(file_path, mode); }
+    explicit file_device() noexcept
+        : m_file(nullptr), m_filename(), m_mode(access_mode::read), m_instruments(), m_content(), m_position(0), m_in_memory(false), m_open_id(0){};
+    file_device(const std::string& file_path, access_mode mode)
+        : m_file(nullptr), m_filename(), m_mode(access_mode::read), m_instruments(), m_content(), m_position(0), m_in_memory(false), m_open_id(0)
+    {
+      open(file_path, mode);
+    }
+    /// opens \p file_path for reading from \p content, e.g. from a content_cache
+    file_device(const std::string& file_path, blob content)
+        : m_file(nullptr), m_filename(), m_mode(access_mode::read), m_instruments(), m_content(), m_position(0), m_in_memory(false), m_open_id(0)
+    {
+      open(file_path, std::move(content));
+    }
 
     file_device(const file_device&) = delete;
     file_device& operator=(const file_device&) = delete;
 
-    file_device(file_device&&) = delete;
-    file_device& operator=(file_device&&) = delete;
+    file_device(file_device&& other) noexcept
+        : m_file(other.m_file), m_filename(std::move(other.m_filename)), m_mode(other.m_mode), m_instruments(std::move(other.m_instruments)),
+          m_content(std::move(other.m_content)), m_position(other.m_position), m_in_memory(other.m_in_memory),
+          m_open_id(other.m_open_id)
+    {
+      other.m_file = nullptr;
+      other.m_in_memory = false;
+    }
+
+    /// closes the current file first, throws like close()
+    file_device& operator=(file_device&& other)
+    {
+      if (this != &other)
+      {
+        if (is_open())
+        {
+          close();
+        }
+        m_file = other.m_file;
+        m_filename = std::move(other.m_filename);
+        m_mode = other.m_mode;
+        m_instruments = std::move(other.m_instruments);
+        m_content = std::move(other.m_content);
+        m_position = other.m_position;
+        m_in_memory = other.m_in_memory;
+        m_open_id = other.m_open_id;
+        other.m_file = nullptr;
+        other.m_in_memory = false;
+      }
+      return *this;
+    }
 
     ~file_device() noexcept
     {
@@ -53,6 +102,8 @@ namespace physfs
         close();
       }
 
+      m_instruments.attach(filename, mode == access_mode::read);
+      detail::io_probe probe(io_operation::open, m_instruments);
       PHYSFS_File* file = nullptr;
       if (mode == access_mode::read)
       {
@@ -61,68 +112,239 @@ namespace physfs
       else if (mode == access_mode::write)
       {
         file = PHYSFS_openWrite(filename.c_str());
+        detail::vfs_modified(file != nullptr);
       }
       else if (mode == access_mode::append)
       {
         file = PHYSFS_openAppend(filename.c_str());
+        detail::vfs_modified(file != nullptr);
       }
       PHYSFS_CXX_CHECK(file != nullptr);
+      probe.done();
 
       m_file = file;
       m_filename = filename;
+      m_mode = mode;
+      m_open_id = next_open_id();
+    }
+
+    /// Opens \p filename in read mode without a physfs handle, all reads are served from \p content.
+    inline void open(const std::string& filename, blob content)
+    {
+      if (is_open())
+      {
+        close();
+      }
+
+      m_instruments.attach(filename, true);
+      detail::io_probe probe(io_operation::open, m_instruments);
+      m_content = std::move(content);
+      m_position = 0;
+      m_in_memory = true;
+      m_filename = filename;
+      m_mode = access_mode::read;
+      m_open_id = next_open_id();
+      probe.done();
     }
 
     inline void close()
     {
-      PHYSFS_CXX_CHECK(PHYSFS_close(m_file) != 0);
+      detail::io_probe probe(io_operation::close, m_instruments);
+      if (m_in_memory)
+      {
+        m_content = blob();
+        m_in_memory = false;
+        probe.done();
+        return;
+      }
+
+      const int result = PHYSFS_close(m_file);
+      if (m_mode != access_mode::read)
+      {
+        // the size of the written file changed
+        detail::vfs_modified(result);
+      }
+      PHYSFS_CXX_CHECK(result != 0);
+      probe.done();
       m_file = nullptr;
     }
 
-    inline bool is_open() const noexcept { return m_file != nullptr; }
-    inline bool eof() const noexcept { return (PHYSFS_eof(m_file) != 0); }
+    inline bool is_open() const noexcept { return m_file != nullptr || m_in_memory; }
+    inline bool eof() const noexcept { return m_in_memory ? (m_position >= m_content.size()) : (PHYSFS_eof(m_file) != 0); }
+    /// true if the device reads from memory instead of a physfs handle
+    inline bool is_in_memory() const noexcept { return m_in_memory; }
 
     inline std::int64_t read(void* buffer, std::uint64_t length)
     {
+      detail::io_probe probe(io_operation::read, m_instruments);
+      if (m_in_memory)
+      {
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(length, m_content.size() - m_position));
+        if (count > 0)
+        {
+          std::memcpy(buffer, m_content.data() + m_position, count);
+          m_position += count;
+        }
+        probe.done(count);
+        return static_cast<std::int64_t>(count);
+      }
+
       auto read_size = PHYSFS_readBytes(m_file, buffer, length);
       PHYSFS_CXX_CHECK(read_size != -1);
+      probe.done(static_cast<std::uint64_t>(read_size));
       return read_size;
     }
 
     inline std::int64_t write(const void* buffer, std::uint64_t length)
     {
+      detail::io_probe probe(io_operation::write, m_instruments);
+      if (m_in_memory)
+      {
+        throw exception("PHYSFS ERROR: \"" + m_filename + "\" is opened for reading");
+      }
       auto read_size = PHYSFS_writeBytes(m_file, buffer, length);
       PHYSFS_CXX_CHECK(read_size != -1);
+      probe.done(static_cast<std::uint64_t>(read_size));
       return read_size;
     }
 
     inline std::int64_t tell()
     {
-      auto offset = PHYSFS_tell(m_file);
+      detail::io_probe probe(io_operation::tell, m_instruments);
+      auto offset = m_in_memory ? static_cast<PHYSFS_sint64>(m_position) : PHYSFS_tell(m_file);
       PHYSFS_CXX_CHECK(offset != -1);
+      probe.done();
       return offset;
     }
 
     inline bool flush()
     {
-      PHYSFS_CXX_CHECK(PHYSFS_flush(m_file) != 0);
+      detail::io_probe probe(io_operation::flush, m_instruments);
+      PHYSFS_CXX_CHECK(m_in_memory || PHYSFS_flush(m_file) != 0);
+      probe.done();
       return true;
     }
 
-    inline void seek(std::uint64_t pos) { PHYSFS_CXX_CHECK(PHYSFS_seek(m_file, pos) != 0); }
+    inline void seek(std::uint64_t pos)
+    {
+      detail::io_probe probe(io_operation::seek, m_instruments);
+      if (m_in_memory)
+      {
+        if (pos > m_content.size())
+        {
+          throw exception("PHYSFS ERROR: seek past the end of \"" + m_filename + "\"");
+        }
+        m_position = pos;
+      }
+      else
+      {
+        PHYSFS_CXX_CHECK(PHYSFS_seek(m_file, pos) != 0);
+      }
+      probe.seeked(pos);
+    }
+
+    inline void set_buffer(std::uint64_t size) { PHYSFS_CXX_CHECK(m_in_memory || PHYSFS_setBuffer(m_file, size) != 0); }
 
     inline std::int64_t file_length()
     {
-
-      auto length = PHYSFS_fileLength(m_file);
+      auto length = m_in_memory ? static_cast<PHYSFS_sint64>(m_content.size()) : PHYSFS_fileLength(m_file);
       PHYSFS_CXX_CHECK(length != -1);
       return length;
     }
 
+    inline const std::string& filename() const noexcept { return m_filename; }
+    inline access_mode mode() const noexcept { return m_mode; }
+    /// Identifies the current open of the device, unique for the lifetime of the process. Moves keep it, unlike a
+    /// native handle it isn't reused after the file is closed.
+    inline std::uint64_t open_id() const noexcept { return m_open_id; }
+
+    /// nullptr for devices which read from memory
+    inline PHYSFS_File* native_handle() const noexcept { return m_file; }
+
+    /// gives up the ownership of the physfs handle, the device is closed afterwards
+    inline PHYSFS_File* release() noexcept
+    {
+      PHYSFS_File* file = m_file;
+      m_file = nullptr;
+      m_content = blob();
+      m_in_memory = false;
+      return file;
+    }
+
   private:
+    static inline std::uint64_t next_open_id() noexcept
+    {
+      static std::atomic<std::uint64_t> counter(0);
+      return ++counter;
+    }
+
     PHYSFS_File* m_file;
     std::string m_filename;
+    access_mode m_mode;
+    detail::file_instruments m_instruments;
+    blob m_content;
+    std::uint64_t m_position;
+    bool m_in_memory;
+    std::uint64_t m_open_id;
   };
 
+  /// Reads the whole file into \p buffer and returns the number of bytes read.
+  /// Throws if the file is larger than \p capacity, nothing is allocated.
+  inline std::uint64_t read_all(const std::string& filename, void* buffer, std::uint64_t capacity)
+  {
+    file_device device(filename, access_mode::read);
+    const auto length = static_cast<std::uint64_t>(device.file_length());
+    if (length > capacity)
+    {
+      throw exception("PHYSFS ERROR: buffer too small for \"" + filename + "\"");
+    }
+    return static_cast<std::uint64_t>(device.read(buffer, length));
+  }
+
+  /// Replaces the content of \p target with the whole file, the container is sized once from the file length.
+  /// Works with every contiguous container of bytes which provides resize() and data(), e.g. std::vector or std::string.
+  template <typename Container>
+  inline void read_all(const std::string& filename, Container& target)
+  {
+    static_assert(sizeof(typename Container::value_type) == 1, "read_all needs a container of bytes");
+
+    file_device device(filename, access_mode::read);
+    target.resize(static_cast<typename Container::size_type>(device.file_length()));
+    if (!target.empty())
+    {
+      const auto count = device.read(&target[0], target.size());
+      target.resize(static_cast<typename Container::size_type>(count));
+    }
+  }
+
+  template <typename Container = std::vector<char>>
+  inline Container read_all(const std::string& filename)
+  {
+    Container target;
+    read_all(filename, target);
+    return target;
+  }
+
+  /// Reads the whole file into a shared immutable blob with a single allocation for the content.
+  inline blob read_all_shared(const std::string& filename)
+  {
+    file_device device(filename, access_mode::read);
+    char* storage = nullptr;
+    blob data = blob::allocate(static_cast<std::size_t>(device.file_length()), storage);
+    const auto count = device.read(storage, data.size());
+    return (static_cast<std::size_t>(count) < data.size()) ? data.slice(0, static_cast<std::size_t>(count)) : data;
+  }
+
+  /// Mounts the archive in the opened file \p device. On success physfs takes over the handle and \p device is closed.
+  inline mount_guard mount_handle(file_device& device, const std::string& name, const std::string& mount_point, bool append = true)
+  {
+    detail::io_probe probe(io_operation::mount, name);
+    PHYSFS_CXX_CHECK(detail::mounted(name, PHYSFS_mountHandle(device.native_handle(), name.c_str(), mount_point.c_str(), (append ? 1 : 0))) != 0);
+    probe.done();
+    device.release();
+    return mount_guard(name);
+  }
+
 } // namespace physfs
 
 #endif /*PHYSFS_CXX_FILE_DEVICE_HXX*/
\ No newline at end of file
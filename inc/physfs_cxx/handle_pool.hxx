@@ -0,0 +1,246 @@
+#ifndef PHYSFS_CXX_HANDLE_POOL_HXX
+#define PHYSFS_CXX_HANDLE_POOL_HXX
+
+#include <physfs.h>
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core.hxx"
+#include "file_device.hxx"
+
+namespace physfs
+{
+  struct handle_pool_stats
+  {
+    /// acquires served by an idle handle
+    std::uint64_t hits;
+    /// acquires which opened a new handle
+    std::uint64_t misses;
+    /// idle handles closed to stay below the capacity
+    std::uint64_t evictions;
+    /// idle handles closed because the search path changed since they were opened
+    std::uint64_t invalidations;
+    std::size_t idle;
+    std::size_t capacity;
+  };
+
+  /// Thread safe pool of open read handles. Released handles stay open and are handed out again by the next acquire()
+  /// for the same file, which saves the lookup and the archive entry setup of PHYSFS_openRead. The least recently
+  /// released handles are closed to keep at most capacity() handles idle.
+  ///
+  /// Idle handles are dropped after mount_generation() changed. They still keep their archives from being unmounted
+  /// (PHYSFS_ERR_FILES_STILL_OPEN), call clear() before unmounting. The pool has to be cleared or destroyed before deinit().
+  ///
+  /// \code
+  /// physfs::handle_pool pool;
+  /// auto device = pool.acquire("maps/level1.map");
+  /// device.read(header, sizeof(header));
+  /// pool.release(std::move(device));
+  /// \endcode
+  class handle_pool
+  {
+  public:
+    static const std::size_t default_capacity = 32;
+
+    explicit handle_pool(std::size_t capacity = default_capacity)
+        : m_mutex(), m_idle(), m_lent(), m_generation(mount_generation()), m_capacity(capacity), m_hits(0), m_misses(0), m_evictions(0), m_invalidations(0)
+    {
+    }
+
+    handle_pool(const handle_pool&) = delete;
+    handle_pool& operator=(const handle_pool&) = delete;
+
+    /// A device opened for reading \p filename and positioned at the start, an idle handle is reused if possible.
+    /// Throws like file_device::open() if the file can't be opened.
+    file_device acquire(const std::string& filename)
+    {
+      const std::uint64_t generation = mount_generation();
+      std::vector<file_device> stale;
+      file_device device;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drop_stale(generation, stale);
+
+        for (auto it = m_idle.begin(); it != m_idle.end(); ++it)
+        {
+          if (it->device.filename() == filename)
+          {
+            device = std::move(it->device);
+            m_idle.erase(it);
+            break;
+          }
+        }
+        if (device.is_open())
+        {
+          ++m_hits;
+        }
+        else
+        {
+          ++m_misses;
+        }
+      }
+
+      if (device.is_open())
+      {
+        device.seek(0);
+      }
+      else
+      {
+        device.open(filename, access_mode::read);
+      }
+
+      // devices acquired before the last stale check aren't recorded and won't be pooled again
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (generation == m_generation)
+      {
+        m_lent[device.native_handle()] = lent_handle{device.open_id(), generation};
+      }
+      return device;
+    }
+
+    /// Returns \p device to the pool. Devices which weren't acquired from this pool, or which were acquired before the
+    /// search path changed, are closed instead.
+    void release(file_device device)
+    {
+      if (!device.is_open() || device.mode() != access_mode::read || device.is_in_memory())
+      {
+        return;
+      }
+
+      const std::uint64_t generation = mount_generation();
+      std::vector<file_device> closed;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      drop_stale(generation, closed);
+
+      // handles acquired before the search path changed were dropped from m_lent by drop_stale(), the open id tells
+      // a lent device apart from an unrelated one which got the address of a lent handle that was never released
+      auto lent = m_lent.find(device.native_handle());
+      if (lent == m_lent.end() || lent->second.open_id != device.open_id())
+      {
+        return;
+      }
+      m_lent.erase(lent);
+      if (m_capacity == 0)
+      {
+        return;
+      }
+
+      m_idle.push_front(idle_handle{std::move(device), generation});
+      while (m_idle.size() > m_capacity)
+      {
+        closed.push_back(std::move(m_idle.back().device));
+        m_idle.pop_back();
+        ++m_evictions;
+      }
+      // closed and stale handles are closed by their destructors
+    }
+
+    /// closes all idle handles
+    void clear()
+    {
+      std::list<idle_handle> idle;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      idle.swap(m_idle);
+    }
+
+    /// changes the capacity, the least recently released handles are closed right away if needed
+    void set_capacity(std::size_t capacity)
+    {
+      std::vector<file_device> closed;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_capacity = capacity;
+      while (m_idle.size() > m_capacity)
+      {
+        closed.push_back(std::move(m_idle.back().device));
+        m_idle.pop_back();
+        ++m_evictions;
+      }
+    }
+
+    inline std::size_t capacity() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_capacity;
+    }
+
+    handle_pool_stats stats() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return handle_pool_stats{m_hits, m_misses, m_evictions, m_invalidations, m_idle.size(), m_capacity};
+    }
+
+    /// clears the counters, the idle handles stay
+    void reset_stats()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_hits = 0;
+      m_misses = 0;
+      m_evictions = 0;
+      m_invalidations = 0;
+    }
+
+  private:
+    struct idle_handle
+    {
+      file_device device;
+      /// mount generation at which the handle was released
+      std::uint64_t generation;
+    };
+
+    struct lent_handle
+    {
+      std::uint64_t open_id;
+      /// mount generation at which the handle was checked
+      std::uint64_t generation;
+    };
+
+    /// moves the idle handles released before \p generation to \p stale, they are closed once the lock is released
+    inline void drop_stale(std::uint64_t generation, std::vector<file_device>& stale)
+    {
+      if (generation == m_generation)
+      {
+        return;
+      }
+      m_generation = generation;
+      for (auto it = m_lent.begin(); it != m_lent.end();)
+      {
+        it = (it->second.generation != generation) ? m_lent.erase(it) : std::next(it);
+      }
+      for (auto it = m_idle.begin(); it != m_idle.end();)
+      {
+        if (it->generation != generation)
+        {
+          stale.push_back(std::move(it->device));
+          it = m_idle.erase(it);
+          ++m_invalidations;
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    mutable std::mutex m_mutex;
+    /// most recently released first
+    std::list<idle_handle> m_idle;
+    /// handles given out by acquire() of the current mount generation
+    std::unordered_map<PHYSFS_File*, lent_handle> m_lent;
+    /// mount generation of the last stale check
+    std::uint64_t m_generation;
+    std::size_t m_capacity;
+    std::uint64_t m_hits;
+    std::uint64_t m_misses;
+    std::uint64_t m_evictions;
+    std::uint64_t m_invalidations;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_HANDLE_POOL_HXX*/
@@ -0,0 +1,426 @@
+#ifndef PHYSFS_CXX_INSTRUMENTATION_HXX
+#define PHYSFS_CXX_INSTRUMENTATION_HXX
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <string>
+
+#ifdef PHYSFS_CXX_INSTRUMENTATION
+#include <atomic>
+#include <memory>
+#include <mutex>
+#endif
+
+namespace physfs
+{
+  /// Operations recorded by the I/O instrumentation. It is compiled in by defining PHYSFS_CXX_INSTRUMENTATION
+  /// (the same way in every translation unit), otherwise all hooks are empty and snapshots stay empty.
+  enum class io_operation : int
+  {
+    open,
+    read,
+    write,
+    seek,
+    tell,
+    flush,
+    close,
+    mount,
+    unmount,
+    stat,
+    enumerate
+  };
+  static const std::size_t io_operation_count = 11;
+
+#ifdef PHYSFS_CXX_INSTRUMENTATION
+  static const bool instrumentation_enabled = true;
+#else
+  static const bool instrumentation_enabled = false;
+#endif
+
+  /// latency buckets double from 256 ns, the last bucket collects everything above about one second
+  static const std::size_t latency_bucket_count = 24;
+
+  /// exclusive upper bound in nanoseconds of latency bucket \p index
+  inline std::uint64_t latency_bucket_limit(std::size_t index) noexcept
+  {
+    return (index + 1 < latency_bucket_count) ? (std::uint64_t(256) << index) : std::numeric_limits<std::uint64_t>::max();
+  }
+
+  struct operation_stats
+  {
+    std::uint64_t calls;
+    std::uint64_t errors;
+    std::uint64_t bytes;
+    std::uint64_t total_ns;
+    std::uint64_t max_ns;
+    std::array<std::uint64_t, latency_bucket_count> latency;
+
+    /// upper bound of the bucket which contains the \p fraction (0..1) percentile of the latency
+    inline std::uint64_t percentile_ns(double fraction) const noexcept
+    {
+      const auto threshold = static_cast<std::uint64_t>(fraction * static_cast<double>(calls));
+      std::uint64_t count = 0;
+      for (std::size_t i = 0; i < latency_bucket_count; ++i)
+      {
+        count += latency[i];
+        if (count > 0 && count >= threshold)
+        {
+          return std::min(latency_bucket_limit(i), max_ns);
+        }
+      }
+      return 0;
+    }
+  };
+
+  struct io_stats
+  {
+    std::array<operation_stats, io_operation_count> operations;
+    /// Seek directions are recorded in the total and by mount only, the file statistics keep them at 0. Backward seeks
+    /// are expensive in compressed archives whose entries are decompressed again from the start, the mount statistics
+    /// tell those archives apart from directories.
+    std::uint64_t forward_seeks;
+    std::uint64_t backward_seeks;
+    /// distance of all backward seeks
+    std::uint64_t backward_seek_bytes;
+
+    inline const operation_stats& operator[](io_operation operation) const noexcept { return operations[static_cast<std::size_t>(operation)]; }
+  };
+
+  /// Statistics of all calls, by virtual file name and by search path entry (archive or directory, or write dir).
+  /// Calls on names which weren't found (failed opens, stats and enumerations) are only recorded in the total. stat and
+  /// enumerate aren't recorded by mount, that would take another search path lookup per call.
+  struct io_snapshot
+  {
+    io_stats total;
+    std::map<std::string, io_stats> files;
+    std::map<std::string, io_stats> mounts;
+  };
+
+#ifdef PHYSFS_CXX_INSTRUMENTATION
+
+  namespace detail
+  {
+    inline std::uint64_t take(std::atomic<std::uint64_t>& counter, bool reset) noexcept
+    {
+      return reset ? counter.exchange(0, std::memory_order_relaxed) : counter.load(std::memory_order_relaxed);
+    }
+
+    struct operation_counters
+    {
+      operation_counters() noexcept
+      {
+        calls.store(0);
+        errors.store(0);
+        bytes.store(0);
+        total_ns.store(0);
+        max_ns.store(0);
+        for (auto& bucket : latency)
+        {
+          bucket.store(0);
+        }
+      }
+
+      inline void record(std::uint64_t duration_ns, std::uint64_t count, bool success) noexcept
+      {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        if (!success)
+        {
+          errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        bytes.fetch_add(count, std::memory_order_relaxed);
+        total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+
+        auto current = max_ns.load(std::memory_order_relaxed);
+        while (duration_ns > current && !max_ns.compare_exchange_weak(current, duration_ns, std::memory_order_relaxed))
+        {
+        }
+
+        std::size_t bucket = 0;
+        while (duration_ns >= latency_bucket_limit(bucket))
+        {
+          ++bucket;
+        }
+        latency[bucket].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      inline operation_stats load(bool reset) noexcept
+      {
+        operation_stats values{};
+        values.calls = take(calls, reset);
+        values.errors = take(errors, reset);
+        values.bytes = take(bytes, reset);
+        values.total_ns = take(total_ns, reset);
+        values.max_ns = take(max_ns, reset);
+        for (std::size_t i = 0; i < latency_bucket_count; ++i)
+        {
+          values.latency[i] = take(latency[i], reset);
+        }
+        return values;
+      }
+
+      std::atomic<std::uint64_t> calls;
+      std::atomic<std::uint64_t> errors;
+      std::atomic<std::uint64_t> bytes;
+      std::atomic<std::uint64_t> total_ns;
+      std::atomic<std::uint64_t> max_ns;
+      std::array<std::atomic<std::uint64_t>, latency_bucket_count> latency;
+    };
+
+    struct io_counters
+    {
+      io_counters() noexcept
+      {
+        forward_seeks.store(0);
+        backward_seeks.store(0);
+        backward_seek_bytes.store(0);
+      }
+
+      inline io_stats load(bool reset) noexcept
+      {
+        io_stats values{};
+        for (std::size_t i = 0; i < io_operation_count; ++i)
+        {
+          values.operations[i] = operations[i].load(reset);
+        }
+        values.forward_seeks = take(forward_seeks, reset);
+        values.backward_seeks = take(backward_seeks, reset);
+        values.backward_seek_bytes = take(backward_seek_bytes, reset);
+        return values;
+      }
+
+      std::array<operation_counters, io_operation_count> operations;
+      std::atomic<std::uint64_t> forward_seeks;
+      std::atomic<std::uint64_t> backward_seeks;
+      std::atomic<std::uint64_t> backward_seek_bytes;
+    };
+
+    /// Counters are created on first use and shared with the devices which record to them. A reset removes the file
+    /// counters which aren't held by a device anymore, so the file statistics don't grow with every name ever opened.
+    class io_registry
+    {
+    public:
+      static inline io_registry& instance()
+      {
+        static io_registry registry;
+        return registry;
+      }
+
+      inline io_counters& total() noexcept { return m_total; }
+      inline std::shared_ptr<io_counters> file(const std::string& name) { return find(m_files, name); }
+      inline std::shared_ptr<io_counters> mount(const std::string& name) { return find(m_mounts, name); }
+
+      inline io_snapshot snapshot(bool reset)
+      {
+        io_snapshot values;
+        values.total = m_total.load(reset);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_files.begin(); it != m_files.end();)
+        {
+          values.files.emplace(it->first, it->second->load(reset));
+          // new references are only handed out under the lock, an unused entry stays unused until it is erased
+          it = (reset && it->second.use_count() == 1) ? m_files.erase(it) : std::next(it);
+        }
+        for (auto& entry : m_mounts)
+        {
+          values.mounts.emplace(entry.first, entry.second->load(reset));
+        }
+        return values;
+      }
+
+    private:
+      using counter_map = std::map<std::string, std::shared_ptr<io_counters>>;
+
+      inline std::shared_ptr<io_counters> find(counter_map& counters, const std::string& name)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = counters[name];
+        if (!entry)
+        {
+          entry = std::make_shared<io_counters>();
+        }
+        return entry;
+      }
+
+      std::mutex m_mutex;
+      io_counters m_total;
+      counter_map m_files;
+      counter_map m_mounts;
+    };
+
+    /// per device state of the instrumentation, the position is tracked to tell backward from forward seeks
+    struct file_instruments
+    {
+      std::shared_ptr<io_counters> file;
+      std::shared_ptr<io_counters> mount;
+      std::uint64_t position = 0;
+
+      /// without a search path entry for \p filename the open fails, it is recorded in the total only
+      inline void attach(const std::string& filename, bool reading)
+      {
+        auto& registry = io_registry::instance();
+        const char* source = reading ? PHYSFS_getRealDir(filename.c_str()) : PHYSFS_getWriteDir();
+        file = (source != nullptr) ? registry.file(filename) : nullptr;
+        mount = (source != nullptr) ? registry.mount(source) : nullptr;
+        position = 0;
+      }
+    };
+
+    /// Measures one call from construction to done(), a probe destroyed before done() records a failed call.
+    class io_probe
+    {
+      using clock = std::chrono::steady_clock;
+
+    public:
+      io_probe(io_operation operation, file_instruments& device) noexcept
+          : m_operation(operation), m_device(&device), m_path(nullptr), m_start(clock::now()), m_done(false)
+      {
+      }
+
+      /// \p path is the mounted search path entry for mount and unmount, otherwise a virtual file name
+      io_probe(io_operation operation, const std::string& path) noexcept
+          : m_operation(operation), m_device(nullptr), m_path(&path), m_start(clock::now()), m_done(false)
+      {
+      }
+
+      io_probe(const io_probe&) = delete;
+      io_probe& operator=(const io_probe&) = delete;
+
+      ~io_probe() noexcept
+      {
+        if (!m_done)
+        {
+          record(0, false);
+        }
+      }
+
+      inline void done(std::uint64_t bytes = 0) noexcept
+      {
+        m_done = true;
+        record(bytes, true);
+      }
+
+      inline void seeked(std::uint64_t target) noexcept
+      {
+        m_done = true;
+        record(0, true, target);
+      }
+
+    private:
+      void record(std::uint64_t bytes, bool success, std::uint64_t seek_target = 0) noexcept
+      {
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start).count();
+        const auto duration_ns = static_cast<std::uint64_t>(std::max<clock::rep>(duration, 0));
+        auto& registry = io_registry::instance();
+
+        // the file and mount counters are held until the call is recorded, a concurrent reset may prune them
+        std::shared_ptr<io_counters> file;
+        std::shared_ptr<io_counters> mount;
+        try
+        {
+          if (m_device != nullptr)
+          {
+            file = m_device->file;
+            mount = m_device->mount;
+          }
+          else if (m_operation == io_operation::mount || m_operation == io_operation::unmount)
+          {
+            mount = registry.mount(*m_path);
+          }
+          else if (success)
+          {
+            file = registry.file(*m_path);
+          }
+        }
+        catch (...)
+        {
+          // out of memory for new counters, the call is only recorded in the total
+        }
+
+        const std::size_t operation = static_cast<std::size_t>(m_operation);
+        registry.total().operations[operation].record(duration_ns, bytes, success);
+        if (file)
+        {
+          file->operations[operation].record(duration_ns, bytes, success);
+        }
+        if (mount)
+        {
+          mount->operations[operation].record(duration_ns, bytes, success);
+        }
+
+        const bool seek = success && m_device != nullptr && m_operation == io_operation::seek;
+        const std::array<io_counters*, 2> seek_targets{{&registry.total(), mount.get()}};
+        for (io_counters* counters : seek_targets)
+        {
+          if (counters == nullptr)
+          {
+            continue;
+          }
+          if (seek && seek_target < m_device->position)
+          {
+            counters->backward_seeks.fetch_add(1, std::memory_order_relaxed);
+            counters->backward_seek_bytes.fetch_add(m_device->position - seek_target, std::memory_order_relaxed);
+          }
+          else if (seek && seek_target > m_device->position)
+          {
+            counters->forward_seeks.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+
+        if (seek)
+        {
+          m_device->position = seek_target;
+        }
+        else if (m_device != nullptr && success && (m_operation == io_operation::read || m_operation == io_operation::write))
+        {
+          m_device->position += bytes;
+        }
+      }
+
+      io_operation m_operation;
+      file_instruments* m_device;
+      const std::string* m_path;
+      clock::time_point m_start;
+      bool m_done;
+    };
+  } // namespace detail
+
+  /// Statistics since the start or the last reset, with \p reset the counters are cleared while they are read.
+  inline io_snapshot snapshot_io_stats(bool reset = false) { return detail::io_registry::instance().snapshot(reset); }
+  inline void reset_io_stats() { detail::io_registry::instance().snapshot(true); }
+
+#else
+
+  namespace detail
+  {
+    struct file_instruments
+    {
+      inline void attach(const std::string&, bool) noexcept {}
+    };
+
+    class io_probe
+    {
+    public:
+      io_probe(io_operation, file_instruments&) noexcept {}
+      io_probe(io_operation, const std::string&) noexcept {}
+
+      inline void done(std::uint64_t = 0) noexcept {}
+      inline void seeked(std::uint64_t) noexcept {}
+    };
+  } // namespace detail
+
+  inline io_snapshot snapshot_io_stats(bool = false) { return io_snapshot{}; }
+  inline void reset_io_stats() {}
+
+#endif
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_INSTRUMENTATION_HXX*/
@@ -0,0 +1,291 @@
+#ifndef PHYSFS_CXX_LOADER_HXX
+#define PHYSFS_CXX_LOADER_HXX
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "blob.hxx"
+#include "error.hxx"
+#include "file_device.hxx"
+
+namespace physfs
+{
+  /// Loads whole files on a pool of worker threads.
+  ///
+  /// Requests with a higher priority are started first, requests with the same priority in submission order.
+  /// Every worker opens its own file_device, so reading and inflating of archive entries happens in parallel.
+  /// The number of bytes in flight is bounded, a single file larger than the bound is still loaded but only if nothing
+  /// else is in flight. A file counts from its read until its completion handler returns, data kept afterwards (e.g. by
+  /// the futures of load()) is not counted.
+  class loader
+  {
+  public:
+    /// Called exactly once per request. Loaded or failed requests complete on a worker thread, cancelled requests on the
+    /// thread which calls cancel(), cancel_all() or the destructor. \p error is set if the load failed or was cancelled.
+    /// Handlers shouldn't throw (exceptions are logged and dropped) and must not wait for other requests of the same
+    /// loader, their bytes stay in flight until the handler returns.
+    typedef std::function<void(const std::string& path, blob data, std::exception_ptr error)> completion_handler;
+
+    static const std::uint64_t default_max_bytes_in_flight = 64 * 1024 * 1024;
+
+    explicit loader(std::size_t threads = default_thread_count(), std::uint64_t max_bytes_in_flight = default_max_bytes_in_flight)
+        : m_mutex(), m_work_available(), m_work_done(), m_budget_available(), m_requests(), m_workers(), m_max_bytes_in_flight(max_bytes_in_flight),
+          m_bytes_in_flight(0), m_active(0), m_sequence(0), m_stop(false)
+    {
+      threads = std::max<std::size_t>(threads, 1);
+      m_workers.reserve(threads);
+      for (std::size_t i = 0; i < threads; ++i)
+      {
+        m_workers.emplace_back(&loader::work, this);
+      }
+    }
+
+    loader(const loader&) = delete;
+    loader& operator=(const loader&) = delete;
+
+    /// cancels all pending requests and waits for the running ones
+    ~loader() noexcept
+    {
+      cancel_all();
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_work_available.notify_all();
+      m_budget_available.notify_all();
+      for (auto& worker : m_workers)
+      {
+        worker.join();
+      }
+    }
+
+    inline void load(const std::string& path, completion_handler handler, int priority = 0)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.insert(std::make_pair(request_key{-priority, m_sequence++}, request{path, std::move(handler)}));
+      }
+      m_work_available.notify_one();
+    }
+
+    inline std::future<blob> load(const std::string& path, int priority = 0)
+    {
+      auto promise = std::make_shared<std::promise<blob>>();
+      auto result = promise->get_future();
+      load(path,
+           [promise](const std::string&, blob data, std::exception_ptr error) {
+             if (error)
+             {
+               promise->set_exception(error);
+             }
+             else
+             {
+               promise->set_value(std::move(data));
+             }
+           },
+           priority);
+      return result;
+    }
+
+    inline std::vector<std::future<blob>> load(const std::vector<std::string>& paths, int priority = 0)
+    {
+      std::vector<std::future<blob>> results;
+      results.reserve(paths.size());
+      for (const auto& path : paths)
+      {
+        results.push_back(load(path, priority));
+      }
+      return results;
+    }
+
+    /// Cancels all pending requests for \p path and returns their number. Requests which already started are not affected.
+    inline std::size_t cancel(const std::string& path)
+    {
+      return cancel_if([&path](const std::string& candidate) { return candidate == path; });
+    }
+
+    inline std::size_t cancel_all()
+    {
+      return cancel_if([](const std::string&) { return true; });
+    }
+
+    /// blocks until no request is pending or running
+    inline void wait()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_work_done.wait(lock, [this] { return m_requests.empty() && m_active == 0; });
+    }
+
+    inline std::size_t pending() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_requests.size();
+    }
+
+    inline std::uint64_t bytes_in_flight() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_bytes_in_flight;
+    }
+
+    inline std::size_t thread_count() const noexcept { return m_workers.size(); }
+
+    static inline std::size_t default_thread_count() noexcept { return std::max<std::size_t>(std::thread::hardware_concurrency(), 1); }
+
+  private:
+    /// negated priority and submission sequence, the smallest key is served first
+    typedef std::pair<int, std::uint64_t> request_key;
+
+    struct request
+    {
+      std::string path;
+      completion_handler handler;
+    };
+
+    template <typename Predicate>
+    std::size_t cancel_if(Predicate predicate)
+    {
+      std::vector<request> cancelled;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_requests.begin(); it != m_requests.end();)
+        {
+          if (predicate(it->second.path))
+          {
+            cancelled.push_back(std::move(it->second));
+            it = m_requests.erase(it);
+          }
+          else
+          {
+            ++it;
+          }
+        }
+      }
+
+      for (auto& entry : cancelled)
+      {
+        complete(entry, blob(), std::make_exception_ptr(exception("PHYSFS ERROR: load of \"" + entry.path + "\" cancelled")));
+      }
+      if (!cancelled.empty())
+      {
+        m_work_done.notify_all();
+      }
+      return cancelled.size();
+    }
+
+    static inline void complete(request& entry, blob data, std::exception_ptr error) noexcept
+    {
+      try
+      {
+        entry.handler(entry.path, std::move(data), error);
+      }
+      catch (...)
+      {
+        std::cerr << __FUNCTION__ << " completion handler for \"" << entry.path << "\" threw an exception!" << std::endl;
+      }
+    }
+
+    void work()
+    {
+      for (;;)
+      {
+        request entry;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_work_available.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+          if (m_requests.empty())
+          {
+            return;
+          }
+          entry = std::move(m_requests.begin()->second);
+          m_requests.erase(m_requests.begin());
+          ++m_active;
+        }
+
+        std::uint64_t reserved = 0;
+        blob data;
+        std::exception_ptr error;
+        try
+        {
+          file_device device(entry.path, access_mode::read);
+          const auto length = static_cast<std::uint64_t>(device.file_length());
+          reserved = reserve(length);
+
+          char* storage = nullptr;
+          data = blob::allocate(static_cast<std::size_t>(length), storage);
+          const auto count = static_cast<std::size_t>(device.read(storage, length));
+          if (count < data.size())
+          {
+            data = data.slice(0, count);
+          }
+        }
+        catch (...)
+        {
+          data = blob();
+          error = std::current_exception();
+        }
+
+        // the budget covers the data until the handler is done with it
+        complete(entry, std::move(data), error);
+        release(reserved);
+
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          --m_active;
+        }
+        m_work_done.notify_all();
+      }
+    }
+
+    /// waits until \p length bytes fit into the in flight budget
+    inline std::uint64_t reserve(std::uint64_t length)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_budget_available.wait(lock, [this, length] { return m_bytes_in_flight == 0 || m_bytes_in_flight + length <= m_max_bytes_in_flight; });
+      m_bytes_in_flight += length;
+      return length;
+    }
+
+    inline void release(std::uint64_t length)
+    {
+      if (length != 0)
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_bytes_in_flight -= length;
+        }
+        m_budget_available.notify_all();
+      }
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+    std::condition_variable m_budget_available;
+
+    std::map<request_key, request> m_requests;
+    std::vector<std::thread> m_workers;
+
+    std::uint64_t m_max_bytes_in_flight;
+    std::uint64_t m_bytes_in_flight;
+    std::size_t m_active;
+    std::uint64_t m_sequence;
+    bool m_stop;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_LOADER_HXX*/
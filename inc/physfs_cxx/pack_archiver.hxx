@@ -0,0 +1,1247 @@
+#ifndef PHYSFS_CXX_PACK_ARCHIVER_HXX
+#define PHYSFS_CXX_PACK_ARCHIVER_HXX
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PHYSFS_CXX_PACK_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "blob.hxx"
+#include "core.hxx"
+#include "error.hxx"
+#include "file_device.hxx"
+
+namespace physfs
+{
+  /// File extension of the pack format, physfs selects the archiver by it.
+  static const char* const pack_extension = "pxp";
+
+  namespace detail
+  {
+    /// Layout of a pack (all numbers little endian):
+    ///
+    ///  - header (64 bytes): magic, version, entry count, number of root entries, alignment, block size, size of the name table
+    ///  - index: one record of 48 bytes per entry, sorted by (parent directory, name). The children of a directory are a
+    ///    contiguous range of the index, a directory record holds the first child and the number of children.
+    ///  - name table: the full path of every entry, zero terminated
+    ///  - data: stored entries start at a multiple of the alignment, so a mmaped pack serves them without copying.
+    ///    A compressed entry starts with a table of block offsets followed by blocks of raw deflate data which are
+    ///    decompressed independently, a block with the length of its uncompressed data is stored as is.
+    namespace pack
+    {
+      static const char magic[8] = {'P', 'X', 'P', 'A', 'C', 'K', '\r', '\n'};
+      static const std::uint32_t format_version = 1;
+      static const std::size_t header_size = 64;
+      static const std::size_t record_size = 48;
+      static const std::uint32_t directory_flag = 1;
+      static const std::uint32_t compressed_flag = 2;
+
+      inline std::uint32_t load32(const char* data) noexcept
+      {
+        unsigned char bytes[4];
+        std::memcpy(bytes, data, sizeof(bytes));
+        return std::uint32_t(bytes[0]) | (std::uint32_t(bytes[1]) << 8) | (std::uint32_t(bytes[2]) << 16) | (std::uint32_t(bytes[3]) << 24);
+      }
+
+      inline std::uint64_t load64(const char* data) noexcept { return std::uint64_t(load32(data)) | (std::uint64_t(load32(data + 4)) << 32); }
+
+      inline void store32(char* data, std::uint32_t value) noexcept
+      {
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+          data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+      }
+
+      inline void store64(char* data, std::uint64_t value) noexcept
+      {
+        store32(data, static_cast<std::uint32_t>(value & 0xFFFFFFFF));
+        store32(data + 4, static_cast<std::uint32_t>(value >> 32));
+      }
+
+      /// orders paths by (parent directory, name) like the index
+      inline int compare(const char* left, std::size_t left_length, const char* right, std::size_t right_length) noexcept
+      {
+        const int result = std::memcmp(left, right, std::min(left_length, right_length));
+        if (result != 0)
+        {
+          return result;
+        }
+        return (left_length < right_length) ? -1 : ((left_length > right_length) ? 1 : 0);
+      }
+
+      /// length of the parent directory part of \p path
+      inline std::size_t parent_length(const char* path, std::size_t length) noexcept
+      {
+        while (length > 0 && path[length - 1] != '/')
+        {
+          --length;
+        }
+        return (length > 0) ? length - 1 : 0;
+      }
+
+      inline int compare_paths(const char* left, std::size_t left_length, std::size_t left_parent, const char* right, std::size_t right_length,
+                               std::size_t right_parent) noexcept
+      {
+        const int result = compare(left, left_parent, right, right_parent);
+        if (result != 0)
+        {
+          return result;
+        }
+        const std::size_t left_name = left_parent + (left_parent > 0 ? 1 : 0);
+        const std::size_t right_name = right_parent + (right_parent > 0 ? 1 : 0);
+        return compare(left + left_name, left_length - left_name, right + right_name, right_length - right_name);
+      }
+
+      struct record
+      {
+        std::uint32_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t parent_length;
+        std::uint32_t flags;
+        /// data offset of a file, first child of a directory
+        std::uint64_t offset;
+        /// uncompressed size of a file, number of children of a directory
+        std::uint64_t size;
+        std::uint64_t stored_size;
+        std::int64_t modtime;
+
+        inline bool is_directory() const noexcept { return (flags & directory_flag) != 0; }
+        inline bool is_compressed() const noexcept { return (flags & compressed_flag) != 0; }
+
+        inline void store(char* data) const noexcept
+        {
+          store32(data, name_offset);
+          store32(data + 4, name_length);
+          store32(data + 8, parent_length);
+          store32(data + 12, flags);
+          store64(data + 16, offset);
+          store64(data + 24, size);
+          store64(data + 32, stored_size);
+          store64(data + 40, static_cast<std::uint64_t>(modtime));
+        }
+
+        static inline record load(const char* data) noexcept
+        {
+          return record{load32(data),
+                        load32(data + 4),
+                        load32(data + 8),
+                        load32(data + 12),
+                        load64(data + 16),
+                        load64(data + 24),
+                        load64(data + 32),
+                        static_cast<std::int64_t>(load64(data + 40))};
+        }
+      };
+
+      inline std::uint64_t block_count(std::uint64_t size, std::uint32_t block_size) noexcept { return (size + block_size - 1) / block_size; }
+
+      inline bool read_fully(PHYSFS_Io* io, void* buffer, std::uint64_t length)
+      {
+        auto* target = static_cast<char*>(buffer);
+        while (length > 0)
+        {
+          const PHYSFS_sint64 count = io->read(io, target, length);
+          if (count <= 0)
+          {
+            if (count == 0)
+            {
+              PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            }
+            return false;
+          }
+          target += count;
+          length -= static_cast<std::uint64_t>(count);
+        }
+        return true;
+      }
+
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+      /// raw deflate stream which is ended by the destructor, also if compressing throws
+      class deflater
+      {
+      public:
+        explicit deflater(int level) : m_stream()
+        {
+          std::memset(&m_stream, 0, sizeof(m_stream));
+          if (deflateInit2(&m_stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+          {
+            throw exception("PHYSFS ERROR: couldn't initialize zlib");
+          }
+        }
+
+        ~deflater() { deflateEnd(&m_stream); }
+
+        deflater(const deflater&) = delete;
+        deflater& operator=(const deflater&) = delete;
+
+        inline z_stream& stream() noexcept { return m_stream; }
+
+      private:
+        z_stream m_stream;
+      };
+#endif
+
+      /// An opened pack. It is shared by the archiver and all open entries.
+      class archive
+      {
+      public:
+        archive(const archive&) = delete;
+        archive& operator=(const archive&) = delete;
+
+        ~archive()
+        {
+#ifdef PHYSFS_CXX_PACK_MMAP
+          if (m_map != nullptr)
+          {
+            ::munmap(const_cast<char*>(m_map), static_cast<std::size_t>(m_length));
+          }
+#endif
+          if (m_io != nullptr)
+          {
+            m_io->destroy(m_io);
+          }
+        }
+
+        /// Returns nullptr with the physfs error code set if \p io is no valid pack, on success the archive owns \p io.
+        static std::shared_ptr<archive> open(PHYSFS_Io* io, const char* name, bool for_write, int* claimed)
+        {
+          char header[header_size];
+          const PHYSFS_sint64 length = io->length(io);
+          if (length < static_cast<PHYSFS_sint64>(header_size) || io->seek(io, 0) == 0 || !read_fully(io, header, header_size) ||
+              std::memcmp(header, magic, sizeof(magic)) != 0)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+            return nullptr;
+          }
+          *claimed = 1;
+
+          if (for_write)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_READ_ONLY);
+            return nullptr;
+          }
+          if (load32(header + 8) != format_version)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+            return nullptr;
+          }
+
+          std::shared_ptr<archive> result(new archive(static_cast<std::uint64_t>(length)));
+          result->m_count = load32(header + 12);
+          result->m_root_count = load32(header + 16);
+          result->m_alignment = load32(header + 20);
+          result->m_block_size = load32(header + 24);
+          const std::uint64_t names_size = load64(header + 32);
+
+          const std::uint64_t available = result->m_length - header_size;
+          const std::uint64_t index_size = std::uint64_t(result->m_count) * record_size;
+          if (result->m_root_count > result->m_count || result->m_alignment == 0 || (result->m_alignment & (result->m_alignment - 1)) != 0 ||
+              result->m_block_size == 0 || index_size > available || names_size > available - index_size || (result->m_count > 0 && names_size == 0) ||
+              names_size > std::numeric_limits<std::uint32_t>::max() || index_size + names_size > std::numeric_limits<std::size_t>::max())
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return nullptr;
+          }
+          result->m_names_size = static_cast<std::uint32_t>(names_size);
+
+          if (!result->map(name, header))
+          {
+            result->m_storage.resize(static_cast<std::size_t>(index_size + names_size));
+            if (!result->m_storage.empty() && !read_fully(io, &result->m_storage[0], result->m_storage.size()))
+            {
+              return nullptr;
+            }
+            result->m_index = result->m_storage.data();
+          }
+          result->m_names = result->m_index + index_size;
+          if (names_size > 0 && result->m_names[names_size - 1] != '\0')
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return nullptr;
+          }
+
+          // a mapped pack keeps the handle until opening succeeded, see close_unused_io()
+          result->m_io = io;
+          return result;
+        }
+
+        inline bool is_mapped() const noexcept { return m_map != nullptr; }
+        inline std::uint32_t block_size() const noexcept { return m_block_size; }
+        inline std::uint32_t root_count() const noexcept { return m_root_count; }
+
+        /// decodes and validates record \p index
+        bool load(std::uint32_t index, record& result) const noexcept
+        {
+          if (index >= m_count)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return false;
+          }
+
+          result = record::load(m_index + std::uint64_t(index) * record_size);
+          const bool valid_name = result.name_offset < m_names_size && result.name_length < m_names_size - result.name_offset &&
+                                  m_names[result.name_offset + result.name_length] == '\0' && result.parent_length < std::max<std::uint32_t>(result.name_length, 1);
+          const bool valid_data = result.is_directory() ? (result.offset <= m_count && result.size <= m_count - result.offset)
+                                                        : (result.offset <= m_length && result.stored_size <= m_length - result.offset);
+          if (!valid_name || !valid_data)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return false;
+          }
+          return true;
+        }
+
+        inline const char* path(const record& entry) const noexcept { return m_names + entry.name_offset; }
+        inline const char* name(const record& entry) const noexcept
+        {
+          return path(entry) + entry.parent_length + (entry.parent_length > 0 ? 1 : 0);
+        }
+
+        /// binary search for \p path, the root directory ("") has no record
+        bool find(const char* path, record& result) const noexcept
+        {
+          const std::size_t length = std::strlen(path);
+          const std::size_t parent = parent_length(path, length);
+
+          std::uint32_t first = 0;
+          std::uint32_t count = m_count;
+          while (count > 0)
+          {
+            const std::uint32_t step = count / 2;
+            const std::uint32_t middle = first + step;
+            if (!load(middle, result))
+            {
+              return false;
+            }
+
+            const int order = compare_paths(this->path(result), result.name_length, result.parent_length, path, length, parent);
+            if (order == 0)
+            {
+              return true;
+            }
+            if (order < 0)
+            {
+              first = middle + 1;
+              count -= step + 1;
+            }
+            else
+            {
+              count = step;
+            }
+          }
+          PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+          return false;
+        }
+
+        /// pointer into the mapped pack or nullptr if the pack isn't mapped
+        inline const char* mapped(std::uint64_t offset) const noexcept { return (m_map != nullptr) ? m_map + offset : nullptr; }
+
+        bool read_at(std::uint64_t offset, void* buffer, std::uint64_t length)
+        {
+          if (offset > m_length || length > m_length - offset)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return false;
+          }
+          if (m_map != nullptr)
+          {
+            std::memcpy(buffer, m_map + offset, static_cast<std::size_t>(length));
+            return true;
+          }
+
+          // all entries share the handle of the pack
+          std::lock_guard<std::mutex> lock(m_io_mutex);
+          return m_io->seek(m_io, offset) != 0 && read_fully(m_io, buffer, length);
+        }
+
+        /// hands the handle back to physfs, used if opening fails after the archive took it over
+        inline void release_io() noexcept
+        {
+          m_io = nullptr;
+        }
+
+        /// closes the handle of a mapped pack once opening succeeded, everything is read from the mapping
+        inline void close_unused_io() noexcept
+        {
+          if (m_map != nullptr && m_io != nullptr)
+          {
+            m_io->destroy(m_io);
+            m_io = nullptr;
+          }
+        }
+
+      private:
+        explicit archive(std::uint64_t length) noexcept
+            : m_io(nullptr), m_io_mutex(), m_map(nullptr), m_length(length), m_storage(), m_index(nullptr), m_names(nullptr), m_count(0), m_root_count(0),
+              m_alignment(0), m_block_size(0), m_names_size(0)
+        {
+        }
+
+        /// Maps the pack if \p name is the native file behind the handle. Only archives mounted by path through mount()
+        /// are mapped, the names of memory and handle mounts are arbitrary and may match an unrelated file.
+        bool map(const char* name, const char* header) noexcept
+        {
+#ifdef PHYSFS_CXX_PACK_MMAP
+          if (!detail::is_native_mount(name) || m_length > std::numeric_limits<std::size_t>::max())
+          {
+            return false;
+          }
+
+          const int descriptor = ::open(name, O_RDONLY);
+          if (descriptor < 0)
+          {
+            return false;
+          }
+
+          void* data = MAP_FAILED;
+          struct ::stat info;
+          if (::fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) && static_cast<std::uint64_t>(info.st_size) == m_length)
+          {
+            data = ::mmap(nullptr, static_cast<std::size_t>(m_length), PROT_READ, MAP_PRIVATE, descriptor, 0);
+          }
+          ::close(descriptor);
+
+          if (data == MAP_FAILED)
+          {
+            return false;
+          }
+          if (std::memcmp(data, header, header_size) != 0)
+          {
+            ::munmap(data, static_cast<std::size_t>(m_length));
+            return false;
+          }
+
+          m_map = static_cast<const char*>(data);
+          m_index = m_map + header_size;
+          return true;
+#else
+          (void)name;
+          (void)header;
+          return false;
+#endif
+        }
+
+        PHYSFS_Io* m_io;
+        std::mutex m_io_mutex;
+        const char* m_map;
+        std::uint64_t m_length;
+        std::vector<char> m_storage;
+        const char* m_index;
+        const char* m_names;
+        std::uint32_t m_count;
+        std::uint32_t m_root_count;
+        std::uint32_t m_alignment;
+        std::uint32_t m_block_size;
+        std::uint32_t m_names_size;
+      };
+
+      /// Open file of a pack, exposed to physfs as PHYSFS_Io.
+      class entry_stream
+      {
+      public:
+        entry_stream(std::shared_ptr<archive> owner, const record& entry)
+            : m_archive(std::move(owner)), m_entry(entry), m_position(0), m_blocks(), m_block(), m_block_index(no_block), m_compressed()
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+              ,
+              m_inflater(), m_inflater_ready(false)
+#endif
+        {
+        }
+
+        entry_stream(const entry_stream&) = delete;
+        entry_stream& operator=(const entry_stream&) = delete;
+
+        ~entry_stream()
+        {
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+          if (m_inflater_ready)
+          {
+            inflateEnd(&m_inflater);
+          }
+#endif
+        }
+
+        /// Returns nullptr with the physfs error code set if the entry can't be read.
+        static PHYSFS_Io* create(const std::shared_ptr<archive>& owner, const record& entry)
+        {
+          std::unique_ptr<entry_stream> stream(new entry_stream(owner, entry));
+          if (entry.is_compressed() && !stream->load_blocks())
+          {
+            return nullptr;
+          }
+
+          PHYSFS_Io* io = new PHYSFS_Io;
+          io->version = 0;
+          io->opaque = stream.release();
+          io->read = &entry_stream::read;
+          io->write = &entry_stream::write;
+          io->seek = &entry_stream::seek;
+          io->tell = &entry_stream::tell;
+          io->length = &entry_stream::length;
+          io->duplicate = &entry_stream::duplicate;
+          io->flush = &entry_stream::flush;
+          io->destroy = &entry_stream::destroy;
+          return io;
+        }
+
+      private:
+        static const std::uint64_t no_block = ~std::uint64_t(0);
+
+        static inline entry_stream& self(PHYSFS_Io* io) noexcept { return *static_cast<entry_stream*>(io->opaque); }
+
+        static PHYSFS_sint64 read(PHYSFS_Io* io, void* buffer, PHYSFS_uint64 length)
+        {
+          try
+          {
+            return self(io).read(static_cast<char*>(buffer), length);
+          }
+          catch (...)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+            return -1;
+          }
+        }
+
+        static PHYSFS_sint64 write(PHYSFS_Io*, const void*, PHYSFS_uint64)
+        {
+          PHYSFS_setErrorCode(PHYSFS_ERR_READ_ONLY);
+          return -1;
+        }
+
+        static int seek(PHYSFS_Io* io, PHYSFS_uint64 offset)
+        {
+          entry_stream& stream = self(io);
+          if (offset > stream.m_entry.size)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_PAST_EOF);
+            return 0;
+          }
+          stream.m_position = offset;
+          return 1;
+        }
+
+        static PHYSFS_sint64 tell(PHYSFS_Io* io) { return static_cast<PHYSFS_sint64>(self(io).m_position); }
+        static PHYSFS_sint64 length(PHYSFS_Io* io) { return static_cast<PHYSFS_sint64>(self(io).m_entry.size); }
+
+        static PHYSFS_Io* duplicate(PHYSFS_Io* io)
+        {
+          try
+          {
+            const entry_stream& stream = self(io);
+            return create(stream.m_archive, stream.m_entry);
+          }
+          catch (...)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+            return nullptr;
+          }
+        }
+
+        static int flush(PHYSFS_Io*) { return 1; }
+
+        static void destroy(PHYSFS_Io* io)
+        {
+          delete static_cast<entry_stream*>(io->opaque);
+          delete io;
+        }
+
+        PHYSFS_sint64 read(char* buffer, std::uint64_t length)
+        {
+          length = std::min(length, m_entry.size - m_position);
+          if (!m_entry.is_compressed())
+          {
+            if (length > 0 && !m_archive->read_at(m_entry.offset + m_position, buffer, length))
+            {
+              return -1;
+            }
+            m_position += length;
+            return static_cast<PHYSFS_sint64>(length);
+          }
+
+          const std::uint64_t block_size = m_archive->block_size();
+          std::uint64_t done = 0;
+          while (done < length)
+          {
+            const std::uint64_t index = m_position / block_size;
+            if (index != m_block_index && !load_block(index))
+            {
+              return (done > 0) ? static_cast<PHYSFS_sint64>(done) : -1;
+            }
+            const std::uint64_t offset = m_position - index * block_size;
+            const std::uint64_t count = std::min<std::uint64_t>(length - done, m_block.size() - offset);
+            std::memcpy(buffer + done, m_block.data() + offset, static_cast<std::size_t>(count));
+            done += count;
+            m_position += count;
+          }
+          return static_cast<PHYSFS_sint64>(done);
+        }
+
+        bool load_blocks()
+        {
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+          const std::uint64_t count = block_count(m_entry.size, m_archive->block_size());
+          const std::uint64_t table_size = (count + 1) * 8;
+          if (count > m_entry.stored_size / 8 || table_size > m_entry.stored_size)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return false;
+          }
+
+          std::vector<char> table(static_cast<std::size_t>(table_size));
+          if (!m_archive->read_at(m_entry.offset, table.data(), table_size))
+          {
+            return false;
+          }
+
+          m_blocks.resize(static_cast<std::size_t>(count + 1));
+          for (std::size_t i = 0; i < m_blocks.size(); ++i)
+          {
+            m_blocks[i] = load64(table.data() + i * 8);
+            if ((i == 0 && m_blocks[i] != table_size) || (i > 0 && m_blocks[i] < m_blocks[i - 1]) || m_blocks[i] > m_entry.stored_size)
+            {
+              PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+              return false;
+            }
+          }
+          return true;
+#else
+          PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+          return false;
+#endif
+        }
+
+        bool load_block(std::uint64_t index)
+        {
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+          const std::uint64_t block_size = m_archive->block_size();
+          const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(block_size, m_entry.size - index * block_size));
+          const std::uint64_t offset = m_entry.offset + m_blocks[static_cast<std::size_t>(index)];
+          const auto stored = static_cast<std::size_t>(m_blocks[static_cast<std::size_t>(index) + 1] - m_blocks[static_cast<std::size_t>(index)]);
+
+          m_block_index = no_block;
+          m_block.resize(size);
+          if (stored == size)
+          {
+            if (!m_archive->read_at(offset, m_block.data(), size))
+            {
+              return false;
+            }
+            m_block_index = index;
+            return true;
+          }
+
+          const char* input = m_archive->mapped(offset);
+          if (input == nullptr)
+          {
+            m_compressed.resize(stored);
+            if (!m_archive->read_at(offset, m_compressed.data(), stored))
+            {
+              return false;
+            }
+            input = m_compressed.data();
+          }
+
+          if (!m_inflater_ready)
+          {
+            std::memset(&m_inflater, 0, sizeof(m_inflater));
+            if (inflateInit2(&m_inflater, -MAX_WBITS) != Z_OK)
+            {
+              PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+              return false;
+            }
+            m_inflater_ready = true;
+          }
+          else
+          {
+            inflateReset(&m_inflater);
+          }
+
+          m_inflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+          m_inflater.avail_in = static_cast<uInt>(stored);
+          m_inflater.next_out = reinterpret_cast<Bytef*>(m_block.data());
+          m_inflater.avail_out = static_cast<uInt>(size);
+          if (inflate(&m_inflater, Z_FINISH) != Z_STREAM_END || m_inflater.avail_out != 0)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
+            return false;
+          }
+          m_block_index = index;
+          return true;
+#else
+          (void)index;
+          PHYSFS_setErrorCode(PHYSFS_ERR_UNSUPPORTED);
+          return false;
+#endif
+        }
+
+        std::shared_ptr<archive> m_archive;
+        record m_entry;
+        std::uint64_t m_position;
+        std::vector<std::uint64_t> m_blocks;
+        std::vector<char> m_block;
+        std::uint64_t m_block_index;
+        std::vector<char> m_compressed;
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+        z_stream m_inflater;
+        bool m_inflater_ready;
+#endif
+      };
+
+      /// packs by their search path entry, used by read_all_mapped()
+      class archive_registry
+      {
+      public:
+        static inline archive_registry& instance()
+        {
+          static archive_registry registry;
+          return registry;
+        }
+
+        inline void add(const std::string& name, const std::shared_ptr<archive>& pack)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_archives[name] = pack;
+        }
+
+        inline void remove(const std::string& name, const archive* pack) noexcept
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto found = m_archives.find(name);
+          if (found != m_archives.end() && found->second.lock().get() == pack)
+          {
+            m_archives.erase(found);
+          }
+        }
+
+        inline std::shared_ptr<archive> find(const std::string& name) const
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto found = m_archives.find(name);
+          return (found != m_archives.end()) ? found->second.lock() : nullptr;
+        }
+
+      private:
+        mutable std::mutex m_mutex;
+        std::map<std::string, std::weak_ptr<archive>> m_archives;
+      };
+
+      /// the callbacks of the PHYSFS_Archiver, the opaque archive pointer is a heap allocated std::shared_ptr<archive>
+      struct archiver
+      {
+        struct handle
+        {
+          std::string name;
+          std::shared_ptr<archive> pack;
+        };
+
+        static inline handle& self(void* opaque) noexcept { return *static_cast<handle*>(opaque); }
+
+        static void* open_archive(PHYSFS_Io* io, const char* name, int for_write, int* claimed)
+        {
+          std::shared_ptr<archive> pack;
+          try
+          {
+            pack = archive::open(io, name, for_write != 0, claimed);
+            if (!pack)
+            {
+              return nullptr;
+            }
+            std::unique_ptr<handle> opened(new handle{(name != nullptr) ? name : "", pack});
+            archive_registry::instance().add(opened->name, pack);
+            pack->close_unused_io();
+            return opened.release();
+          }
+          catch (...)
+          {
+            if (pack)
+            {
+              pack->release_io();
+            }
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+            return nullptr;
+          }
+        }
+
+        static PHYSFS_EnumerateCallbackResult enumerate(void* opaque, const char* dirname, PHYSFS_EnumerateCallback callback, const char* origdir,
+                                                        void* callbackdata)
+        {
+          const archive& pack = *self(opaque).pack;
+          std::uint64_t first = 0;
+          std::uint64_t count = pack.root_count();
+          if (*dirname != '\0')
+          {
+            record directory;
+            if (!pack.find(dirname, directory))
+            {
+              return PHYSFS_ENUM_ERROR;
+            }
+            if (!directory.is_directory())
+            {
+              PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+              return PHYSFS_ENUM_ERROR;
+            }
+            first = directory.offset;
+            count = directory.size;
+          }
+
+          record entry;
+          for (std::uint64_t i = first; i < first + count; ++i)
+          {
+            if (!pack.load(static_cast<std::uint32_t>(i), entry))
+            {
+              return PHYSFS_ENUM_ERROR;
+            }
+            const PHYSFS_EnumerateCallbackResult result = callback(callbackdata, origdir, pack.name(entry));
+            if (result == PHYSFS_ENUM_ERROR)
+            {
+              PHYSFS_setErrorCode(PHYSFS_ERR_APP_CALLBACK);
+              return PHYSFS_ENUM_ERROR;
+            }
+            if (result == PHYSFS_ENUM_STOP)
+            {
+              return PHYSFS_ENUM_STOP;
+            }
+          }
+          return PHYSFS_ENUM_OK;
+        }
+
+        static PHYSFS_Io* open_read(void* opaque, const char* filename)
+        {
+          const auto& pack = self(opaque).pack;
+          record entry;
+          if (!pack->find(filename, entry))
+          {
+            return nullptr;
+          }
+          if (entry.is_directory())
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_NOT_A_FILE);
+            return nullptr;
+          }
+
+          try
+          {
+            return entry_stream::create(pack, entry);
+          }
+          catch (...)
+          {
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+            return nullptr;
+          }
+        }
+
+        static PHYSFS_Io* open_write(void*, const char*)
+        {
+          PHYSFS_setErrorCode(PHYSFS_ERR_READ_ONLY);
+          return nullptr;
+        }
+
+        static int modify(void*, const char*)
+        {
+          PHYSFS_setErrorCode(PHYSFS_ERR_READ_ONLY);
+          return 0;
+        }
+
+        static int stat(void* opaque, const char* filename, PHYSFS_Stat* stat)
+        {
+          const archive& pack = *self(opaque).pack;
+          record entry{0, 0, 0, directory_flag, 0, 0, 0, -1};
+          if (*filename != '\0' && !pack.find(filename, entry))
+          {
+            return 0;
+          }
+
+          stat->filesize = entry.is_directory() ? 0 : static_cast<PHYSFS_sint64>(entry.size);
+          stat->modtime = entry.modtime;
+          stat->createtime = entry.modtime;
+          stat->accesstime = -1;
+          stat->filetype = entry.is_directory() ? PHYSFS_FILETYPE_DIRECTORY : PHYSFS_FILETYPE_REGULAR;
+          stat->readonly = 1;
+          return 1;
+        }
+
+        static void close_archive(void* opaque)
+        {
+          std::unique_ptr<handle> opened(&self(opaque));
+          archive_registry::instance().remove(opened->name, opened->pack.get());
+        }
+      };
+    } // namespace pack
+  }   // namespace detail
+
+  /// The archiver for packs (see pack_writer), register it with register_pack_archiver() after init().
+  inline const PHYSFS_Archiver& pack_archiver() noexcept
+  {
+    static const PHYSFS_Archiver archiver = {0,
+                                             {pack_extension, "physfs_cxx pack with a sorted index and block compression", "physfs_cxx",
+                                              "https://github.com/zie87/physfs_cxx", 0},
+                                             &detail::pack::archiver::open_archive,
+                                             &detail::pack::archiver::enumerate,
+                                             &detail::pack::archiver::open_read,
+                                             &detail::pack::archiver::open_write,
+                                             &detail::pack::archiver::open_write,
+                                             &detail::pack::archiver::modify,
+                                             &detail::pack::archiver::modify,
+                                             &detail::pack::archiver::stat,
+                                             &detail::pack::archiver::close_archive};
+    return archiver;
+  }
+
+  inline archiver_guard register_pack_archiver() { return register_archiver(pack_archiver()); }
+
+  /// Like read_all_shared(), but a stored entry of a mmaped pack is returned without copying. The blob keeps the
+  /// mapping alive, even if the pack is unmounted in the meantime.
+  inline blob read_all_mapped(const std::string& filename)
+  {
+    const char* real_dir = PHYSFS_getRealDir(filename.c_str());
+    const char* mount_point = (real_dir != nullptr) ? PHYSFS_getMountPoint(real_dir) : nullptr;
+    auto pack = (mount_point != nullptr) ? detail::pack::archive_registry::instance().find(real_dir) : nullptr;
+    if (pack && pack->is_mapped())
+    {
+      // the path inside the pack without the mount point, both without leading slashes
+      std::string path(filename, std::min(filename.find_first_not_of('/'), filename.size()));
+      std::string prefix(mount_point);
+      prefix.erase(0, std::min(prefix.find_first_not_of('/'), prefix.size()));
+      if (path.compare(0, prefix.size(), prefix) == 0)
+      {
+        path.erase(0, prefix.size());
+        detail::pack::record entry;
+        if (pack->find(path.c_str(), entry) && !entry.is_directory() && !entry.is_compressed())
+        {
+          return blob(std::shared_ptr<const char>(pack, pack->mapped(entry.offset)), static_cast<std::size_t>(entry.size));
+        }
+      }
+    }
+    return read_all_shared(filename);
+  }
+
+  /// Builds packs for the pack archiver.
+  ///
+  /// Files are added from memory or from the virtual file system (e.g. a mounted directory or zip), the content of the
+  /// latter is read while the pack is written. Parent directories are added implicitly.
+  class pack_writer
+  {
+  public:
+    static const int default_compression = 6;
+    static const std::uint32_t default_block_size = 64 * 1024;
+    static const std::uint32_t default_alignment = 64;
+
+    /// \p compression is the zlib level, 0 stores all files. A file is only compressed if that makes it smaller.
+    explicit pack_writer(int compression = default_compression, std::uint32_t block_size = default_block_size, std::uint32_t alignment = default_alignment)
+        : m_compression(compression), m_block_size(block_size), m_alignment(alignment), m_entries()
+    {
+      if (block_size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+      {
+        throw exception("PHYSFS ERROR: invalid pack block size or alignment");
+      }
+    }
+
+    inline void add_file(const std::string& path, blob data, std::int64_t modtime = -1) { add(path, false, std::move(data), std::string(), modtime); }
+
+    inline void add_directory(const std::string& path, std::int64_t modtime = -1) { add(path, true, blob(), std::string(), modtime); }
+
+    /// adds the content of the virtual directory \p dir below \p prefix
+    void add_tree(const std::string& dir, const std::string& prefix = std::string())
+    {
+      for (const auto& name : enumerate_files(dir))
+      {
+        const std::string source(dir.empty() ? name : dir + "/" + name);
+        const std::string target(prefix.empty() ? name : prefix + "/" + name);
+        const file_stat info = get_file_stat(source);
+        if (info.type() == filetype::directory)
+        {
+          add(target, true, blob(), std::string(), info.modification_time());
+          add_tree(source, target);
+        }
+        else
+        {
+          add(target, false, blob(), source, info.modification_time());
+        }
+      }
+    }
+
+    /// number of files and directories
+    inline std::size_t size() const noexcept { return m_entries.size(); }
+
+    /// Writes the pack to \p out starting at its current position, the offsets in the pack are relative to that position.
+    /// \p out has to be seekable and must not be opened in append mode, the index is written last.
+    void write(std::ostream& out) const
+    {
+      using namespace detail::pack;
+
+      const std::streampos base = out.tellp();
+      if (base == std::streampos(-1))
+      {
+        throw exception("PHYSFS ERROR: the pack stream isn't seekable");
+      }
+
+      std::vector<const entry*> sorted;
+      for (const auto& item : m_entries)
+      {
+        sorted.push_back(&item.second);
+      }
+      std::sort(sorted.begin(), sorted.end(), [](const entry* left, const entry* right) {
+        return compare_paths(left->path.data(), left->path.size(), parent_length(left->path.data(), left->path.size()), right->path.data(),
+                             right->path.size(), parent_length(right->path.data(), right->path.size())) < 0;
+      });
+      if (sorted.size() > std::numeric_limits<std::uint32_t>::max())
+      {
+        throw exception("PHYSFS ERROR: too many entries for a pack");
+      }
+
+      // the children of a directory follow each other in the sorted index
+      std::map<std::string, std::pair<std::uint64_t, std::uint64_t>> children;
+      std::vector<record> records(sorted.size());
+      std::string names;
+      for (std::size_t i = 0; i < sorted.size(); ++i)
+      {
+        const std::string& path = sorted[i]->path;
+        const std::size_t parent = parent_length(path.data(), path.size());
+        auto& range = children.emplace(path.substr(0, parent), std::make_pair(std::uint64_t(i), std::uint64_t(0))).first->second;
+        ++range.second;
+
+        records[i] = record{static_cast<std::uint32_t>(names.size()),
+                            static_cast<std::uint32_t>(path.size()),
+                            static_cast<std::uint32_t>(parent),
+                            sorted[i]->directory ? directory_flag : 0,
+                            0,
+                            0,
+                            0,
+                            sorted[i]->modtime};
+        names.append(path.c_str(), path.size() + 1);
+      }
+      if (names.size() > std::numeric_limits<std::uint32_t>::max())
+      {
+        throw exception("PHYSFS ERROR: too many names for a pack");
+      }
+
+      const std::uint64_t data_start = header_size + sorted.size() * record_size + names.size();
+      std::vector<char> index(static_cast<std::size_t>(data_start), '\0');
+      std::memcpy(&index[header_size + sorted.size() * record_size], names.data(), names.size());
+      write_bytes(out, index.data(), index.size());
+
+      std::uint64_t position = data_start;
+      for (std::size_t i = 0; i < sorted.size(); ++i)
+      {
+        record& current = records[i];
+        if (sorted[i]->directory)
+        {
+          auto found = children.find(sorted[i]->path);
+          if (found != children.end())
+          {
+            current.offset = found->second.first;
+            current.size = found->second.second;
+          }
+          continue;
+        }
+
+        const blob data = sorted[i]->source.empty() ? sorted[i]->data : read_all_shared(sorted[i]->source);
+        const std::string compressed = compress(data);
+        const bool store = compressed.empty();
+        // stored entries are aligned for mmaped access
+        const std::uint64_t padding = store ? (m_alignment - position % m_alignment) % m_alignment : 0;
+        write_padding(out, padding);
+        position += padding;
+
+        current.offset = position;
+        current.size = data.size();
+        current.flags |= store ? 0 : compressed_flag;
+        current.stored_size = store ? data.size() : compressed.size();
+        if (store)
+        {
+          write_bytes(out, data.data(), data.size());
+        }
+        else
+        {
+          write_bytes(out, compressed.data(), compressed.size());
+        }
+        position += current.stored_size;
+      }
+
+      const auto root = children.find(std::string());
+      std::memcpy(&index[0], magic, sizeof(magic));
+      store32(&index[8], format_version);
+      store32(&index[12], static_cast<std::uint32_t>(sorted.size()));
+      store32(&index[16], (root != children.end()) ? static_cast<std::uint32_t>(root->second.second) : 0);
+      store32(&index[20], m_alignment);
+      store32(&index[24], m_block_size);
+      store64(&index[32], names.size());
+      for (std::size_t i = 0; i < records.size(); ++i)
+      {
+        records[i].store(&index[header_size + i * record_size]);
+      }
+
+      const std::size_t index_size = header_size + records.size() * record_size;
+      out.seekp(base);
+      write_bytes(out, index.data(), index_size);
+      // in append mode the index was added at the end, which only shows once it is flushed
+      out.flush();
+      if (out.tellp() != base + static_cast<std::streamoff>(index_size))
+      {
+        throw exception("PHYSFS ERROR: couldn't rewrite the pack index, the stream isn't seekable or in append mode");
+      }
+      out.seekp(0, std::ios_base::end);
+      out.flush();
+      if (!out.good())
+      {
+        throw exception("PHYSFS ERROR: couldn't write the pack");
+      }
+    }
+
+  private:
+    struct entry
+    {
+      std::string path;
+      bool directory;
+      blob data;
+      /// virtual file which is read while writing, empty for data from memory
+      std::string source;
+      std::int64_t modtime;
+    };
+
+    /// strips slashes and rejects empty, "." and ".." path elements
+    static std::string normalize(const std::string& path)
+    {
+      std::string result;
+      std::size_t start = path.find_first_not_of('/');
+      while (start != std::string::npos)
+      {
+        const std::size_t end = std::min(path.find('/', start), path.size());
+        const std::string element(path, start, end - start);
+        if (element == "." || element == "..")
+        {
+          throw exception("PHYSFS ERROR: invalid path \"" + path + "\" for a pack");
+        }
+        result += (result.empty() ? "" : "/") + element;
+        start = path.find_first_not_of('/', end);
+      }
+      if (result.empty())
+      {
+        throw exception("PHYSFS ERROR: invalid path \"" + path + "\" for a pack");
+      }
+      return result;
+    }
+
+    void add(const std::string& path, bool directory, blob data, std::string source, std::int64_t modtime)
+    {
+      const std::string normalized = normalize(path);
+      const std::size_t parent = detail::pack::parent_length(normalized.data(), normalized.size());
+      if (parent > 0)
+      {
+        const auto found = m_entries.find(normalized.substr(0, parent));
+        if (found == m_entries.end())
+        {
+          add(normalized.substr(0, parent), true, blob(), std::string(), modtime);
+        }
+        else if (!found->second.directory)
+        {
+          throw exception("PHYSFS ERROR: \"" + found->first + "\" is no directory");
+        }
+      }
+
+      auto found = m_entries.find(normalized);
+      if (found != m_entries.end() && found->second.directory != directory)
+      {
+        throw exception("PHYSFS ERROR: \"" + normalized + "\" is added as file and as directory");
+      }
+      m_entries[normalized] = entry{normalized, directory, std::move(data), std::move(source), modtime};
+    }
+
+    /// the block table and blocks of a compressed entry or an empty string if the entry should be stored
+    std::string compress(const blob& data) const
+    {
+#ifdef PHYSFS_CXX_HAVE_ZLIB
+      if (m_compression <= 0 || data.empty())
+      {
+        return std::string();
+      }
+
+      detail::pack::deflater guard(m_compression);
+      z_stream& deflater = guard.stream();
+
+      const std::uint64_t count = detail::pack::block_count(data.size(), m_block_size);
+      std::string result(static_cast<std::size_t>((count + 1) * 8), '\0');
+      std::vector<char> block(deflateBound(&deflater, m_block_size));
+      for (std::uint64_t i = 0; i < count; ++i)
+      {
+        detail::pack::store64(&result[static_cast<std::size_t>(i * 8)], result.size());
+
+        const char* input = data.data() + i * m_block_size;
+        const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(m_block_size, data.size() - i * m_block_size));
+        deflateReset(&deflater);
+        deflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+        deflater.avail_in = static_cast<uInt>(size);
+        deflater.next_out = reinterpret_cast<Bytef*>(block.data());
+        deflater.avail_out = static_cast<uInt>(block.size());
+        const bool finished = (deflate(&deflater, Z_FINISH) == Z_STREAM_END);
+        const std::size_t compressed = block.size() - deflater.avail_out;
+
+        // blocks which don't shrink are stored, the reader tells them apart by their length
+        if (finished && compressed < size)
+        {
+          result.append(block.data(), compressed);
+        }
+        else
+        {
+          result.append(input, size);
+        }
+      }
+      detail::pack::store64(&result[static_cast<std::size_t>(count * 8)], result.size());
+
+      return (result.size() < data.size()) ? result : std::string();
+#else
+      (void)data;
+      return std::string();
+#endif
+    }
+
+    static void write_bytes(std::ostream& out, const char* data, std::size_t size)
+    {
+      out.write(data, static_cast<std::streamsize>(size));
+      if (!out.good())
+      {
+        throw exception("PHYSFS ERROR: couldn't write the pack");
+      }
+    }
+
+    static void write_padding(std::ostream& out, std::uint64_t size)
+    {
+      static const char zeros[64] = {};
+      while (size > 0)
+      {
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(size, sizeof(zeros)));
+        write_bytes(out, zeros, count);
+        size -= count;
+      }
+    }
+
+    int m_compression;
+    std::uint32_t m_block_size;
+    std::uint32_t m_alignment;
+    std::map<std::string, entry> m_entries;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_PACK_ARCHIVER_HXX*/
@@ -1,9 +1,17 @@
 #ifndef PHYSFS_CXX_PHYSFS_HXX
 #define PHYSFS_CXX_PHYSFS_HXX
 
+#include "allocator.hxx"
+#include "blob.hxx"
+#include "content_cache.hxx"
 #include "core.hxx"
 #include "error.hxx"
 #include "file_device.hxx"
+#include "handle_pool.hxx"
+#include "instrumentation.hxx"
+#include "loader.hxx"
+#include "pack_archiver.hxx"
 #include "streams.hxx"
+#include "vfs_index.hxx"
 
 #endif /*PHYSFS_CXX_PHYSFS_HXX*/
\ No newline at end of file
@@ -6,18 +6,189 @@
 #include "file_device.hxx"
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace physfs
 {
+  namespace detail
+  {
+    /// Background thread which writes filled stream buffers to a file device in order. The first write error is kept
+    /// and rethrown by every later push() and wait(), buffers queued after an error are dropped.
+    template <typename CharT>
+    class write_behind
+    {
+    public:
+      typedef std::vector<CharT> buffer_type;
+
+      write_behind(file_device& device, std::size_t max_pending)
+          : m_mutex(), m_work_available(), m_work_done(), m_space_available(), m_device(&device), m_queue(), m_spare(),
+            m_max_pending(std::max<std::size_t>(max_pending, 1)), m_busy(false), m_stop(false), m_error(), m_worker()
+      {
+        m_worker = std::thread(&write_behind::work, this);
+      }
+
+      write_behind(const write_behind&) = delete;
+      write_behind& operator=(const write_behind&) = delete;
+
+      /// writes everything still queued before the thread ends
+      ~write_behind() noexcept
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stop = true;
+        }
+        m_work_available.notify_one();
+        m_worker.join();
+      }
+
+      /// a buffer of \p size characters, reused from earlier writes if possible
+      inline buffer_type acquire(std::size_t size)
+      {
+        buffer_type buffer;
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (!m_spare.empty())
+          {
+            buffer = std::move(m_spare.back());
+            m_spare.pop_back();
+          }
+        }
+        buffer.resize(size);
+        return buffer;
+      }
+
+      /// Queues the first \p count characters of \p buffer, blocks while the queue is full.
+      inline void push(buffer_type&& buffer, std::size_t count)
+      {
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_space_available.wait(lock, [this] { return m_error || m_queue.size() < m_max_pending; });
+          if (m_error)
+          {
+            std::rethrow_exception(m_error);
+          }
+          m_queue.push_back(pending{std::move(buffer), count});
+        }
+        m_work_available.notify_one();
+      }
+
+      /// blocks until everything queued is written
+      inline void wait()
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work_done.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+        if (m_error)
+        {
+          std::rethrow_exception(m_error);
+        }
+      }
+
+      /// waits until the thread is idle and continues with \p device, used when the owning stream is moved
+      inline void rebind(file_device& device)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work_done.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+        m_device = &device;
+      }
+
+    private:
+      struct pending
+      {
+        buffer_type buffer;
+        std::size_t count;
+      };
+
+      void work()
+      {
+        for (;;)
+        {
+          pending entry;
+          bool failed = false;
+          {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+              return;
+            }
+            entry = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+            failed = static_cast<bool>(m_error);
+          }
+          m_space_available.notify_one();
+
+          std::exception_ptr error;
+          if (!failed)
+          {
+            try
+            {
+              write(entry);
+            }
+            catch (...)
+            {
+              error = std::current_exception();
+            }
+          }
+
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy = false;
+            if (error)
+            {
+              m_error = error;
+            }
+            m_spare.push_back(std::move(entry.buffer));
+          }
+          m_work_done.notify_all();
+          m_space_available.notify_one();
+        }
+      }
+
+      inline void write(const pending& entry)
+      {
+        const char* data = reinterpret_cast<const char*>(entry.buffer.data());
+        std::uint64_t remaining = entry.count * sizeof(CharT);
+        while (remaining > 0)
+        {
+          const std::int64_t written = m_device->write(data, remaining);
+          if (written <= 0)
+          {
+            throw exception("PHYSFS ERROR: couldn't write to \"" + m_device->filename() + "\"");
+          }
+          data += written;
+          remaining -= static_cast<std::uint64_t>(written);
+        }
+      }
+
+      std::mutex m_mutex;
+      std::condition_variable m_work_available;
+      std::condition_variable m_work_done;
+      std::condition_variable m_space_available;
+
+      file_device* m_device;
+      std::deque<pending> m_queue;
+      std::vector<buffer_type> m_spare;
+      std::size_t m_max_pending;
+      bool m_busy;
+      bool m_stop;
+      std::exception_ptr m_error;
+      std::thread m_worker;
+    };
+  } // namespace detail
 
   template <typename CharT, typename Traits = std::char_traits<CharT>>
   class basic_fstreambuf : public std::basic_streambuf<CharT, Traits>
   {
-    static const unsigned int buffer_size = 32;
-    static const unsigned int put_back_amount = 2;
+    static const std::size_t put_back_amount = 2;
 
   public:
     typedef CharT char_type;
@@ -26,34 +197,139 @@ namespace physfs
     typedef typename traits_type::off_type off_type;
     typedef typename traits_type::pos_type pos_type;
 
-    basic_fstreambuf() noexcept : m_write_buffer(nullptr), m_read_buffer(nullptr) {}
-    basic_fstreambuf(const std::string& filename, access_mode mode) : basic_fstreambuf() { open(filename, mode); }
-    ~basic_fstreambuf() override { close(); }
+    /// buffer size (in characters) used if nothing else is requested
+    static const std::size_t default_buffer_size = 16 * 1024;
+    /// smallest buffer which leaves room for the put back area and one character
+    static const std::size_t min_buffer_size = put_back_amount + 1;
+    /// filled buffers which may wait for the background writer (see set_write_behind)
+    static const std::size_t default_write_behind_pending = 4;
+
+    basic_fstreambuf() noexcept : basic_fstreambuf(default_buffer_size) {}
+    explicit basic_fstreambuf(std::size_t buffer_size) noexcept
+        : m_buffer(nullptr), m_buffer_size(std::max(buffer_size, min_buffer_size)), m_owns_buffer(true), m_mode(access_mode::read), m_write_behind_pending(0),
+          m_writer(), m_behind_buffer()
+    {
+    }
+    basic_fstreambuf(const std::string& filename, access_mode mode, std::size_t buffer_size = default_buffer_size) : basic_fstreambuf(buffer_size)
+    {
+      open(filename, mode);
+    }
+    /// waits until pending background writes of \p other are done
+    basic_fstreambuf(basic_fstreambuf&& other) : basic_fstreambuf(other.m_buffer_size) { take(other); }
+    ~basic_fstreambuf() override
+    {
+      try
+      {
+        close();
+      }
+      catch (exception& e)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't close file! : " << e.what() << std::endl;
+      }
+      catch (...)
+      {
+        std::cerr << __FUNCTION__ << " Couldn't close file! unexpected exception!" << std::endl;
+      }
+      release_buffer();
+    }
+
+    /// closes the current file first, throws like close()
+    basic_fstreambuf& operator=(basic_fstreambuf&& other)
+    {
+      if (this != &other)
+      {
+        close();
+        release_buffer();
+        take(other);
+      }
+      return *this;
+    }
 
     inline basic_fstreambuf* open(const std::string& filename, access_mode mode)
     {
+      close();
       m_file_device.open(filename, mode);
+      m_mode = mode;
       create_buffers(mode);
       return this;
     }
 
+    /// opens \p filename for reading from \p content (see file_device)
+    inline basic_fstreambuf* open(const std::string& filename, blob content)
+    {
+      close();
+      m_file_device.open(filename, std::move(content));
+      m_mode = access_mode::read;
+      create_buffers(m_mode);
+      return this;
+    }
+
+    /// Writes pending output and closes the file, the file is closed even if writing fails.
+    /// Returns nullptr if pending output couldn't be written, errors of the background writer are rethrown.
     inline basic_fstreambuf* close()
     {
-      if (is_open())
+      if (!is_open())
       {
-        sync();
-        destroy_buffers();
-        m_file_device.close();
+        return this;
       }
-      return this;
+
+      bool synced = false;
+      std::exception_ptr error;
+      try
+      {
+        synced = drain_buffer();
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+      destroy_buffers();
+      m_file_device.close();
+
+      if (error)
+      {
+        std::rethrow_exception(error);
+      }
+      return synced ? this : nullptr;
     }
 
     inline bool is_open() const noexcept { return m_file_device.is_open(); }
+    inline std::size_t buffer_size() const noexcept { return m_buffer_size; }
+
+    /// Hands filled output buffers to a background thread which writes them, at most \p max_pending buffers wait before
+    /// further output blocks. sync() and close() wait for the thread and report its first write error, after an error
+    /// nothing more is written. A size of 0 switches back to synchronous writes. Applies to files opened for writing or
+    /// appending, the setting is kept for later opens. The put area is allocated internally, a buffer set with setbuf()
+    /// only provides its size while this is enabled.
+    inline void set_write_behind(std::size_t max_pending = default_write_behind_pending)
+    {
+      discard_pending_output();
+      destroy_buffers();
+      m_write_behind_pending = max_pending;
+      if (is_open())
+      {
+        create_buffers(m_mode);
+      }
+    }
+
+    inline bool is_write_behind() const noexcept { return m_write_behind_pending != 0; }
+
+    /// Enables the internal buffer of physfs for the underlying file (see PHYSFS_setBuffer).
+    /// This only pays off for access patterns which bypass the stream buffer, a size of 0 disables it.
+    inline void set_device_buffer(std::uint64_t size)
+    {
+      discard_pending_output();
+      m_file_device.set_buffer(size);
+    }
 
   protected:
+    /// the underlying device for derived stream buffers, it must not be used while background writes are pending
+    inline file_device& device() noexcept { return m_file_device; }
+
     inline int_type overflow(int_type c) override
     {
-      if (!empty_buffer())
+      // closed streams and streams opened for reading have no put area
+      if (this->pbase() == nullptr || !empty_buffer())
       {
         return traits_type::eof();
       }
@@ -96,10 +372,44 @@ namespace physfs
       }
     }
 
-    inline int sync() override { return (is_open() && empty_buffer()) ? 0 : -1; }
+    inline int sync() override { return (is_open() && drain_buffer()) ? 0 : -1; }
+
+    /// Uses \p s with \p n characters as buffer. If \p s is a nullptr an internal buffer of size \p n is allocated instead.
+    /// Pending output is written and buffered input is dropped without changing the stream position.
+    std::basic_streambuf<CharT, Traits>* setbuf(char_type* s, std::streamsize n) override
+    {
+      if (n < static_cast<std::streamsize>(min_buffer_size) || !discard_buffers())
+      {
+        return nullptr;
+      }
+
+      destroy_buffers();
+      release_buffer();
+
+      m_buffer = s;
+      m_owns_buffer = (s == nullptr);
+      m_buffer_size = static_cast<std::size_t>(n);
+
+      if (is_open())
+      {
+        create_buffers(m_mode);
+      }
+      return this;
+    }
 
     std::streamsize xsputn(const char_type* s, std::streamsize n) override
     {
+      if (this->pbase() == nullptr)
+      {
+        return 0;
+      }
+
+      // requests which would fill the whole buffer go straight to the device, unless a background writer owns it
+      if (!m_writer && n >= static_cast<std::streamsize>(m_buffer_size) && n > this->epptr() - this->pptr())
+      {
+        return empty_buffer() ? write(s, n) : 0;
+      }
+
       std::streamsize done = 0;
       while (done < n)
       {
@@ -118,6 +428,41 @@ namespace physfs
       return done;
     }
 
+    std::streamsize xsgetn(char_type* s, std::streamsize n) override
+    {
+      std::streamsize done = 0;
+      while (done < n)
+      {
+        if (std::streamsize nbuf = this->egptr() - this->gptr())
+        {
+          nbuf = std::min(nbuf, n - done);
+          traits_type::copy(s + done, this->gptr(), nbuf);
+          this->gbump(static_cast<int>(nbuf));
+          done += nbuf;
+        }
+        else if (n - done >= static_cast<std::streamsize>(m_buffer_size - put_back_amount))
+        {
+          // read large requests directly into the target and only keep the put back area
+          const std::streamsize nread = read(s + done, n - done);
+          if (nread <= 0)
+          {
+            break;
+          }
+          done += nread;
+
+          const std::streamsize npb = std::min(done, static_cast<std::streamsize>(put_back_amount));
+          char_type* const gbuf = m_buffer + put_back_amount;
+          traits_type::copy(gbuf - npb, s + done - npb, npb);
+          this->setg(gbuf - npb, gbuf, gbuf);
+        }
+        else if (!fill_buffer())
+        {
+          break;
+        }
+      }
+      return done;
+    }
+
     inline std::streamsize write(const char_type* s, std::streamsize n)
     {
       std::streamsize nwritten = m_file_device.write(s, n * sizeof(char_type));
@@ -132,108 +477,199 @@ namespace physfs
 
     inline std::streamsize showmanyc() override
     {
-      std::streamsize avail(0);
-      if (sizeof(char_type) == 1)
+      std::streamsize avail(this->egptr() - this->gptr());
+      if (avail == 0 && sizeof(char_type) == 1)
       {
         avail = fill_buffer() ? this->egptr() - this->gptr() : -1;
       }
       return avail;
     }
 
-    pos_type seekoff(off_type pos, std::ios_base::seekdir dir, std::ios_base::openmode mode) override
+    pos_type seekoff(off_type pos, std::ios_base::seekdir dir, std::ios_base::openmode) override
     {
+      if (!is_open())
+      {
+        return pos_type(off_type(-1));
+      }
+
+      if (m_mode == access_mode::read)
+      {
+        // the device is always positioned at the end of the get area
+        const off_type device_pos = m_file_device.tell();
+        const off_type current_pos = device_pos - (this->egptr() - this->gptr());
+
+        off_type target = pos;
+        if (dir == std::ios_base::cur)
+        {
+          target += current_pos;
+        }
+        else if (dir == std::ios_base::end)
+        {
+          target += m_file_device.file_length();
+        }
+
+        // seeks inside the get area only move the get pointer
+        if (this->eback() != nullptr && target <= device_pos && target >= device_pos - (this->egptr() - this->eback()))
+        {
+          this->setg(this->eback(), this->egptr() - (device_pos - target), this->egptr());
+          return pos_type(target);
+        }
+
+        m_file_device.seek(target);
+        char_type* const gbuf = m_buffer + put_back_amount;
+        this->setg(gbuf, gbuf, gbuf);
+        return pos_type(target);
+      }
+
+      if (!drain_buffer())
+      {
+        return pos_type(off_type(-1));
+      }
+
       if (dir == std::ios_base::beg)
       {
         m_file_device.seek(pos);
       }
-      else if (dir == std::ios_base::cur)
+      else if (dir == std::ios_base::cur && pos != 0)
       {
-        auto current_pos = m_file_device.tell();
-        m_file_device.seek((current_pos + pos) - (this->egptr() - this->gptr()));
+        m_file_device.seek(m_file_device.tell() + pos);
       }
       else if (dir == std::ios_base::end)
       {
-        auto length = m_file_device.file_length();
-        m_file_device.seek(length + pos);
+        m_file_device.seek(m_file_device.file_length() + pos);
+      }
+      return m_file_device.tell();
+    }
+
+    inline pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override { return seekoff(off_type(pos), std::ios_base::beg, mode); }
+
+  protected:
+    inline void create_buffers(access_mode mode)
+    {
+      if (mode != access_mode::read && m_write_behind_pending != 0)
+      {
+        // the put area comes from the background writer, m_buffer isn't needed
+        m_writer.reset(new detail::write_behind<char_type>(m_file_device, m_write_behind_pending));
+        m_behind_buffer = m_writer->acquire(m_buffer_size);
+        this->setp(m_behind_buffer.data(), m_behind_buffer.data() + m_buffer_size);
+        return;
       }
 
-      if (mode & std::ios_base::in)
+      if (m_buffer == nullptr)
       {
-        this->setg(this->egptr(), this->egptr(), this->egptr());
+        m_buffer = new char_type[m_buffer_size];
+        m_owns_buffer = true;
       }
-      if (mode & std::ios_base::out)
+
+      if (mode == access_mode::read)
       {
-        this->setp(m_write_buffer, m_write_buffer + buffer_size);
+        this->setg(m_buffer + put_back_amount, m_buffer + put_back_amount, m_buffer + put_back_amount);
+      }
+      else
+      {
+        this->setp(m_buffer, m_buffer + m_buffer_size);
       }
-      return m_file_device.tell();
     }
 
-    inline pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override
+    /// the background writer finishes queued buffers before it is destroyed
+    inline void destroy_buffers()
     {
-      m_file_device.seek(pos);
-      if (mode & std::ios_base::in)
+      this->setg(nullptr, nullptr, nullptr);
+      this->setp(nullptr, nullptr);
+      m_writer.reset();
+      m_behind_buffer = std::vector<char_type>();
+
+      // a user provided buffer is kept for the next open
+      if (m_owns_buffer)
       {
-        this->setg(this->egptr(), this->egptr(), this->egptr());
+        release_buffer();
       }
-      if (mode & std::ios_base::out)
+    }
+
+    inline void release_buffer()
+    {
+      if (m_owns_buffer)
       {
-        this->setp(m_write_buffer, m_write_buffer + buffer_size);
+        delete[] m_buffer;
       }
-      return m_file_device.tell();
+      m_buffer = nullptr;
+      m_owns_buffer = true;
     }
 
-  protected:
-    inline void create_buffers(access_mode mode)
+    /// Writes pending output and drops buffered input, the position of the device afterwards is the stream position.
+    inline bool discard_buffers()
     {
-      if (mode == access_mode::read)
+      if (!is_open())
       {
-        delete[] m_read_buffer;
-        m_read_buffer = new char_type[buffer_size];
-        this->setg(m_read_buffer + put_back_amount, m_read_buffer + put_back_amount, m_read_buffer + put_back_amount);
+        return true;
       }
-      else
+
+      if (m_mode == access_mode::read)
       {
-        delete[] m_write_buffer;
-        m_write_buffer = new char_type[buffer_size];
-        this->setp(m_write_buffer, m_write_buffer + buffer_size);
+        if (const std::streamsize ahead = this->egptr() - this->gptr())
+        {
+          m_file_device.seek(m_file_device.tell() - ahead);
+        }
+        char_type* const gbuf = m_buffer + put_back_amount;
+        this->setg(gbuf, gbuf, gbuf);
+        return true;
       }
+      return drain_buffer();
     }
 
-    inline void destroy_buffers()
+    /// like discard_buffers() but throws if pending output couldn't be written, the physfs error may not belong to it
+    inline void discard_pending_output()
     {
-      if (m_read_buffer != nullptr)
+      if (!discard_buffers())
       {
-        this->setg(nullptr, nullptr, nullptr);
-        delete[] m_read_buffer;
-        m_read_buffer = nullptr;
+        throw exception("PHYSFS ERROR: couldn't write pending output of \"" + m_file_device.filename() + "\"");
       }
+    }
 
-      if (m_write_buffer != nullptr)
+    /// Writes all buffered characters and waits until the background writer is done with them.
+    inline bool drain_buffer()
+    {
+      if (!empty_buffer())
+      {
+        return false;
+      }
+      if (m_writer)
       {
-        this->setp(nullptr, nullptr);
-        delete[] m_write_buffer;
-        m_write_buffer = nullptr;
+        m_writer->wait();
       }
+      return true;
     }
 
-    /// Writes buffered characters to the process' stdin pipe.
+    /// Writes all buffered characters to the file device, or queues them for the background writer.
     inline bool empty_buffer()
     {
-      const std::streamsize count = this->pptr() - this->pbase();
-      if (count > 0)
+      if (m_writer)
       {
-        const std::streamsize written = this->write(this->m_write_buffer, count);
-        if (written > 0)
+        if (this->pptr() > this->pbase())
         {
-          if (const std::streamsize unwritten = count - written)
-          {
-            traits_type::move(this->pbase(), this->pbase() + written, unwritten);
-          }
-          this->pbump(static_cast<int>(-written));
-          return true;
+          m_writer->push(std::move(m_behind_buffer), static_cast<std::size_t>(this->pptr() - this->pbase()));
+          m_behind_buffer = m_writer->acquire(m_buffer_size);
+          this->setp(m_behind_buffer.data(), m_behind_buffer.data() + m_buffer_size);
         }
+        return true;
       }
-      return false;
+
+      while (this->pptr() > this->pbase())
+      {
+        const std::streamsize count = this->pptr() - this->pbase();
+        const std::streamsize written = this->write(this->pbase(), count);
+        if (written <= 0)
+        {
+          return false;
+        }
+
+        if (const std::streamsize unwritten = count - written)
+        {
+          traits_type::move(this->pbase(), this->pbase() + written, unwritten);
+        }
+        this->pbump(static_cast<int>(-written));
+      }
+      return true;
     }
 
     bool fill_buffer()
@@ -242,7 +678,7 @@ namespace physfs
       const std::streamsize pb2 = put_back_amount;
       const std::streamsize npb = std::min(pb1, pb2);
 
-      char_type* const rbuf = m_read_buffer;
+      char_type* const rbuf = m_buffer;
 
       if (npb)
       {
@@ -251,7 +687,7 @@ namespace physfs
 
       std::streamsize rc = -1;
 
-      rc = read(rbuf + put_back_amount, buffer_size - put_back_amount);
+      rc = read(rbuf + put_back_amount, m_buffer_size - put_back_amount);
 
       if (rc > 0)
       {
@@ -269,12 +705,55 @@ namespace physfs
     basic_fstreambuf(const basic_fstreambuf&) = delete;
     basic_fstreambuf& operator=(const basic_fstreambuf&) = delete;
 
+    /// takes over the file, buffers and areas of \p other, which is left closed
+    inline void take(basic_fstreambuf& other)
+    {
+      if (other.m_writer)
+      {
+        other.m_writer->rebind(m_file_device);
+      }
+      m_file_device = std::move(other.m_file_device);
+      m_buffer = other.m_buffer;
+      m_buffer_size = other.m_buffer_size;
+      m_owns_buffer = other.m_owns_buffer;
+      m_mode = other.m_mode;
+      m_write_behind_pending = other.m_write_behind_pending;
+      m_writer = std::move(other.m_writer);
+      m_behind_buffer = std::move(other.m_behind_buffer);
+
+      this->pubimbue(other.getloc());
+      this->setg(other.eback(), other.gptr(), other.egptr());
+      this->setp(other.pbase(), other.epptr());
+      this->pbump(static_cast<int>(other.pptr() - other.pbase()));
+
+      other.setg(nullptr, nullptr, nullptr);
+      other.setp(nullptr, nullptr);
+      other.m_buffer = nullptr;
+      other.m_owns_buffer = true;
+    }
+
     file_device m_file_device;
 
-    char_type* m_write_buffer;
-    char_type* m_read_buffer;
+    char_type* m_buffer;
+    std::size_t m_buffer_size;
+    bool m_owns_buffer;
+    access_mode m_mode;
+
+    std::size_t m_write_behind_pending;
+    std::unique_ptr<detail::write_behind<char_type>> m_writer;
+    /// put area while the background writer is active
+    std::vector<char_type> m_behind_buffer;
   };
 
+  template <typename CharT, typename Traits>
+  const std::size_t basic_fstreambuf<CharT, Traits>::put_back_amount;
+  template <typename CharT, typename Traits>
+  const std::size_t basic_fstreambuf<CharT, Traits>::default_buffer_size;
+  template <typename CharT, typename Traits>
+  const std::size_t basic_fstreambuf<CharT, Traits>::min_buffer_size;
+  template <typename CharT, typename Traits>
+  const std::size_t basic_fstreambuf<CharT, Traits>::default_write_behind_pending;
+
   template <typename CharT, typename Traits = std::char_traits<CharT>>
   class fstream_common : virtual public std::basic_ios<CharT, Traits>
   {
@@ -282,14 +761,43 @@ namespace physfs
     typedef basic_fstreambuf<CharT, Traits> streambuf_type;
 
     fstream_common() noexcept : std::basic_ios<CharT, Traits>(nullptr), m_filename(), m_buffer() { this->std::basic_ios<CharT, Traits>::rdbuf(&m_buffer); }
-    fstream_common(const std::string& filename, access_mode mode) : std::basic_ios<CharT, Traits>(nullptr), m_filename(filename), m_buffer()
+    fstream_common(const std::string& filename, access_mode mode, std::size_t buffer_size)
+        : std::basic_ios<CharT, Traits>(nullptr), m_filename(filename), m_buffer(buffer_size)
     {
       this->std::basic_ios<CharT, Traits>::rdbuf(&m_buffer);
       do_open(filename, mode);
     }
+    fstream_common(const std::string& filename, blob content, std::size_t buffer_size)
+        : std::basic_ios<CharT, Traits>(nullptr), m_filename(filename), m_buffer(buffer_size)
+    {
+      this->std::basic_ios<CharT, Traits>::rdbuf(&m_buffer);
+      do_open(filename, std::move(content));
+    }
+
+    fstream_common(fstream_common&& other)
+        : std::basic_ios<CharT, Traits>(nullptr), m_filename(std::move(other.m_filename)), m_buffer(std::move(other.m_buffer))
+    {
+      this->std::basic_ios<CharT, Traits>::rdbuf(&m_buffer);
+      take_state(other);
+    }
 
     ~fstream_common() override = default;
 
+    fstream_common& operator=(fstream_common&& other)
+    {
+      m_buffer = std::move(other.m_buffer);
+      m_filename = std::move(other.m_filename);
+      take_state(other);
+      return *this;
+    }
+
+    /// format flags, locale and stream state of \p other
+    inline void take_state(const fstream_common& other)
+    {
+      this->copyfmt(other);
+      this->clear(other.rdstate());
+    }
+
     inline void do_open(const std::string& filename, access_mode mode)
     {
       m_buffer.open((m_filename = filename), mode);
@@ -299,11 +807,19 @@ namespace physfs
       }
     }
 
+    inline void do_open(const std::string& filename, blob content)
+    {
+      m_buffer.open((m_filename = filename), std::move(content));
+      if (!m_buffer.is_open())
+      {
+        this->setstate(std::ios_base::failbit);
+      }
+    }
+
   public:
     inline void close()
     {
-      m_buffer.close();
-      if (m_buffer.is_open())
+      if (m_buffer.close() == nullptr || m_buffer.is_open())
       {
         this->setstate(std::ios_base::failbit);
       }
@@ -324,15 +840,32 @@ namespace physfs
   {
     typedef std::basic_istream<CharT, Traits> istream_type;
     typedef fstream_common<CharT, Traits> stream_base_type;
+    typedef typename stream_base_type::streambuf_type streambuf_type;
 
     using stream_base_type::m_buffer;
 
   public:
     basic_ifstream() noexcept : istream_type(nullptr), stream_base_type() {}
-    explicit basic_ifstream(const std::string& filename, access_mode mode = access_mode::read) : istream_type(nullptr), stream_base_type(filename, mode) {}
+    explicit basic_ifstream(const std::string& filename, access_mode mode = access_mode::read, std::size_t buffer_size = streambuf_type::default_buffer_size)
+        : istream_type(nullptr), stream_base_type(filename, mode, buffer_size)
+    {
+    }
+    /// reads \p filename from \p content, e.g. from a content_cache
+    basic_ifstream(const std::string& filename, blob content, std::size_t buffer_size = streambuf_type::default_buffer_size)
+        : istream_type(nullptr), stream_base_type(filename, std::move(content), buffer_size)
+    {
+    }
+    basic_ifstream(basic_ifstream&& other) : istream_type(nullptr), stream_base_type(std::move(other)) {}
     ~basic_ifstream() override = default;
 
+    basic_ifstream& operator=(basic_ifstream&& other)
+    {
+      stream_base_type::operator=(std::move(other));
+      return *this;
+    }
+
     inline void open(const std::string& filename, access_mode mode = access_mode::read) { this->do_open(filename, mode); }
+    inline void open(const std::string& filename, blob content) { this->do_open(filename, std::move(content)); }
   };
 
   template <typename CharT, typename Traits = std::char_traits<CharT>>
@@ -340,15 +873,31 @@ namespace physfs
   {
     typedef std::basic_ostream<CharT, Traits> ostream_type;
     typedef fstream_common<CharT, Traits> stream_base_type;
+    typedef typename stream_base_type::streambuf_type streambuf_type;
 
     using stream_base_type::m_buffer;
 
   public:
     basic_ofstream() noexcept : ostream_type(nullptr), stream_base_type() {}
-    explicit basic_ofstream(const std::string& filename, access_mode mode = access_mode::write) : ostream_type(nullptr), stream_base_type(filename, mode) {}
+    explicit basic_ofstream(const std::string& filename, access_mode mode = access_mode::write, std::size_t buffer_size = streambuf_type::default_buffer_size)
+        : ostream_type(nullptr), stream_base_type(filename, mode, buffer_size)
+    {
+    }
+    basic_ofstream(basic_ofstream&& other) : ostream_type(nullptr), stream_base_type(std::move(other)) {}
     ~basic_ofstream() override = default;
 
+    basic_ofstream& operator=(basic_ofstream&& other)
+    {
+      stream_base_type::operator=(std::move(other));
+      return *this;
+    }
+
     inline void open(const std::string& filename, access_mode mode = access_mode::write) { this->do_open(filename, mode); }
+
+    /// Writes filled buffers on a background thread so the caller doesn't wait for the disk. flush() and close() wait
+    /// for the writes, a failed write sets the badbit on flush() and makes close() throw (see basic_fstreambuf::set_write_behind).
+    inline void set_write_behind(std::size_t max_pending = streambuf_type::default_write_behind_pending) { m_buffer.set_write_behind(max_pending); }
+    inline bool is_write_behind() const noexcept { return m_buffer.is_write_behind(); }
   };
 
   template <typename CharT, typename Traits = std::char_traits<CharT>>
@@ -356,14 +905,25 @@ namespace physfs
   {
     typedef std::basic_iostream<CharT, Traits> iostream_type;
     typedef fstream_common<CharT, Traits> stream_base_type;
+    typedef typename stream_base_type::streambuf_type streambuf_type;
 
     using stream_base_type::m_buffer;
 
   public:
     basic_fstream() : iostream_type(nullptr), stream_base_type() {}
-    explicit basic_fstream(const std::string& filename, access_mode mode = access_mode::read) : iostream_type(nullptr), stream_base_type(filename, mode) {}
+    explicit basic_fstream(const std::string& filename, access_mode mode = access_mode::read, std::size_t buffer_size = streambuf_type::default_buffer_size)
+        : iostream_type(nullptr), stream_base_type(filename, mode, buffer_size)
+    {
+    }
+    basic_fstream(basic_fstream&& other) : iostream_type(nullptr), stream_base_type(std::move(other)) {}
     ~basic_fstream() = default;
 
+    basic_fstream& operator=(basic_fstream&& other)
+    {
+      stream_base_type::operator=(std::move(other));
+      return *this;
+    }
+
     inline void open(const std::string& filename, access_mode mode = access_mode::read) { this->do_open(filename, mode); }
   };
 
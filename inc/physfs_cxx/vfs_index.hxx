@@ -0,0 +1,263 @@
+#ifndef PHYSFS_CXX_VFS_INDEX_HXX
+#define PHYSFS_CXX_VFS_INDEX_HXX
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core.hxx"
+#include "error.hxx"
+
+namespace physfs
+{
+  /// In-memory index of the virtual file tree for repeated exists/stat/enumerate queries.
+  ///
+  /// A directory is enumerated once on the first query below it, the stat and the real dir of an entry
+  /// are fetched on the first query for that entry. The index drops everything as soon as vfs_generation()
+  /// changes, so mounting, unmounting, changing the write dir and creating or removing files through this
+  /// wrapper is picked up automatically. Changes made directly through the physfs C API need invalidate().
+  /// Paths are sanitized like physfs does, repeated slashes are collapsed and "." or ".." elements throw.
+  class vfs_index
+  {
+  public:
+    vfs_index() : m_mutex(), m_nodes(), m_generation(vfs_generation()) {}
+
+    vfs_index(const vfs_index&) = delete;
+    vfs_index& operator=(const vfs_index&) = delete;
+
+    inline bool exists(const std::string& path)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      refresh();
+      std::string storage;
+      return lookup(normalize(path, storage)).exists;
+    }
+
+    inline file_stat stat(const std::string& path)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      refresh();
+      std::string storage;
+      const std::string& normalized = normalize(path, storage);
+      return file_stat(load_stat(normalized, existing(normalized)));
+    }
+
+    inline std::int64_t file_size(const std::string& path) { return stat(path).size(); }
+
+    inline bool is_readonly(const std::string& path) { return stat(path).is_readonly(); }
+    inline bool is_regular_file(const std::string& path) { return stat(path).type() == filetype::regular; }
+    inline bool is_symlink(const std::string& path) { return stat(path).type() == filetype::symlink; }
+    inline bool is_directory(const std::string& path) { return stat(path).type() == filetype::directory; }
+
+    inline std::string real_dir(const std::string& path)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      refresh();
+      std::string storage;
+      const std::string& normalized = normalize(path, storage);
+      node& entry = existing(normalized);
+      if (!entry.real_dir_loaded)
+      {
+        const char* dir_name = PHYSFS_getRealDir(normalized.c_str());
+        PHYSFS_CXX_CHECK(dir_name != nullptr);
+        entry.real_dir = dir_name;
+        entry.real_dir_loaded = true;
+      }
+      return entry.real_dir;
+    }
+
+    inline file_list enumerate_files(const std::string& dir)
+    {
+      file_list files;
+      enumerate(dir, [&files](const std::string& name) {
+        files.push_back(name);
+        return true;
+      });
+      return files;
+    }
+
+    /// Calls \p callback(const std::string& name) for every entry in \p dir until it returns false.
+    /// The index is locked during the enumeration, so the callback must not use the index.
+    template <typename Callback>
+    inline void enumerate(const std::string& dir, Callback callback)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      refresh();
+      std::string storage;
+      const std::string& normalized = normalize(dir, storage);
+      const node& entry = load_children(normalized, existing(normalized));
+      for (const auto& name : entry.children)
+      {
+        if (!callback(name))
+        {
+          break;
+        }
+      }
+    }
+
+    inline void invalidate()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_nodes.clear();
+      m_generation = vfs_generation();
+    }
+
+    /// number of cached (existing and missing) entries
+    inline std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_nodes.size();
+    }
+
+  private:
+    struct node
+    {
+      explicit node(bool found) noexcept
+          : exists(found), stat_loaded(false), children_loaded(false), real_dir_loaded(false), stat(), children(), real_dir()
+      {
+      }
+
+      bool exists;
+      bool stat_loaded;
+      bool children_loaded;
+      bool real_dir_loaded;
+      PHYSFS_Stat stat;
+      std::vector<std::string> children;
+      std::string real_dir;
+    };
+
+    /// Sanitizes \p path like physfs: leading, trailing and repeated slashes are stripped, the root directory is the
+    /// empty string. "." and ".." elements, ':' and '\\' are rejected with PHYSFS_ERR_BAD_FILENAME.
+    /// \p storage is only used (and returned) if \p path has to be changed.
+    static inline const std::string& normalize(const std::string& path, std::string& storage)
+    {
+      bool invalid = path.find_first_of(":\\") != std::string::npos;
+      bool changed = !path.empty() && path.back() == '/';
+      for (std::size_t start = 0; start < path.size();)
+      {
+        const std::size_t end = std::min(path.find('/', start), path.size());
+        const std::size_t length = end - start;
+        changed = changed || length == 0;
+        invalid = invalid || (length == 1 && path[start] == '.') || (length == 2 && path.compare(start, 2, "..") == 0);
+        start = end + 1;
+      }
+      if (invalid)
+      {
+        PHYSFS_setErrorCode(PHYSFS_ERR_BAD_FILENAME);
+        throw exception();
+      }
+      if (!changed)
+      {
+        return path;
+      }
+
+      storage.clear();
+      for (std::size_t start = path.find_first_not_of('/'); start != std::string::npos;)
+      {
+        const std::size_t end = std::min(path.find('/', start), path.size());
+        storage.append(storage.empty() ? "" : "/").append(path, start, end - start);
+        start = path.find_first_not_of('/', end);
+      }
+      return storage;
+    }
+
+    /// drops all entries if the virtual file tree changed, references to nodes are only valid until the next refresh
+    inline void refresh()
+    {
+      const auto current = vfs_generation();
+      if (current != m_generation)
+      {
+        m_nodes.clear();
+        m_generation = current;
+      }
+    }
+
+    node& lookup(const std::string& path)
+    {
+      auto found = m_nodes.find(path);
+      if (found != m_nodes.end())
+      {
+        return found->second;
+      }
+
+      if (path.empty())
+      {
+        return m_nodes.emplace(path, node(true)).first->second;
+      }
+
+      // entries are only known through the enumeration of their parent
+      const auto separator = path.rfind('/');
+      const std::string parent((separator == std::string::npos) ? std::string() : path.substr(0, separator));
+      node& parent_node = lookup(parent);
+      if (parent_node.exists)
+      {
+        load_children(parent, parent_node);
+        found = m_nodes.find(path);
+        if (found != m_nodes.end())
+        {
+          return found->second;
+        }
+      }
+      return m_nodes.emplace(path, node(false)).first->second;
+    }
+
+    inline node& existing(const std::string& path)
+    {
+      node& entry = lookup(path);
+      if (!entry.exists)
+      {
+        PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+        throw exception();
+      }
+      return entry;
+    }
+
+    const PHYSFS_Stat& load_stat(const std::string& path, node& entry)
+    {
+      if (!entry.stat_loaded)
+      {
+        PHYSFS_CXX_CHECK(PHYSFS_stat(path.c_str(), &entry.stat) != 0);
+        entry.stat_loaded = true;
+      }
+      return entry.stat;
+    }
+
+    const node& load_children(const std::string& dir, node& entry)
+    {
+      if (entry.children_loaded)
+      {
+        return entry;
+      }
+
+      const auto type = load_stat(dir, entry).filetype;
+      if (type == PHYSFS_FILETYPE_DIRECTORY || type == PHYSFS_FILETYPE_SYMLINK)
+      {
+        const std::string prefix(dir.empty() ? dir : dir + "/");
+        std::vector<std::string> children;
+        physfs::enumerate(dir, [&](const char* name) {
+          // physfs reports names which exist in several search paths more than once
+          if (m_nodes.emplace(prefix + name, node(true)).second)
+          {
+            children.emplace_back(name);
+          }
+          return true;
+        });
+        entry.children.swap(children);
+      }
+      entry.children_loaded = true;
+      return entry;
+    }
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, node> m_nodes;
+    std::uint64_t m_generation;
+  };
+
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_VFS_INDEX_HXX*/
@@ -0,0 +1,108 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      sample mount_unmount_archives(const data_layout& layout)
+      {
+        sample work{0, 0};
+        for (const auto& source : archive_sources())
+        {
+          const std::string mount_point("allocator_" + source);
+          mount(layout.archive(source), mount_point);
+          unmount(layout.archive(source));
+          ++work.operations;
+        }
+        return work;
+      }
+
+      sample read_files(const std::vector<std::string>& files)
+      {
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          work.bytes += read_all_shared(filename).size();
+          ++work.operations;
+        }
+        return work;
+      }
+
+      sample load_files(const std::vector<std::string>& files)
+      {
+        loader batch_loader(4);
+        auto results = batch_loader.load(files);
+
+        sample work{0, 0};
+        for (auto& result : results)
+        {
+          work.bytes += result.get().size();
+          ++work.operations;
+        }
+        return work;
+      }
+
+      void run_workload(runner& bench_runner, const data_layout& layout, const std::string& variant)
+      {
+        const std::string suite("allocator");
+
+        // an archive which is already mounted would not be mounted again
+        bench_runner.run(suite, "mount_unmount_archives", variant, [&] { return mount_unmount_archives(layout); });
+        mount_sources(layout);
+
+        for (const auto& source : sources())
+        {
+          std::vector<std::string> files;
+          for (std::size_t i = 0; i < layout.small_files; ++i)
+          {
+            files.push_back(source + "/" + data_layout::small_file(i));
+          }
+
+          bench_runner.run(suite, source + "/read_small_files", variant, [&] { return read_files(files); });
+          bench_runner.run(suite, source + "/load_small_files/threads=4", variant, [&] { return load_files(files); });
+        }
+        unmount_sources(layout);
+      }
+
+      void print_stats(const std::string& variant, const allocator& backend)
+      {
+        const auto stats = backend.stats();
+        std::cerr << "  " << variant << ": " << stats.allocations << " allocations, peak " << stats.peak_bytes << " bytes, live " << stats.live_bytes
+                  << " bytes, per size class:";
+        for (std::size_t i = 0; i < size_class_count; ++i)
+        {
+          std::cerr << " " << stats.class_allocations[i];
+        }
+        std::cerr << std::endl;
+      }
+
+    } // namespace
+
+    void run_allocator_benchmarks(runner& bench_runner, const data_layout& layout, const char* argv0)
+    {
+      {
+        init_guard guard(argv0);
+        run_workload(bench_runner, layout, "default");
+      }
+
+      system_allocator system;
+      {
+        init_guard guard(argv0, system);
+        run_workload(bench_runner, layout, "system");
+      }
+      print_stats("system", system);
+
+      pool_allocator pool;
+      {
+        init_guard guard(argv0, pool);
+        run_workload(bench_runner, layout, "pool");
+      }
+      print_stats("pool", pool);
+    }
+
+  } // namespace bench
+} // namespace physfs
@@ -0,0 +1,387 @@
+#include "bench_data.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      const std::string directory_source("dir");
+
+      /// small deterministic generator, the data has to be identical between runs
+      class text_generator
+      {
+      public:
+        explicit text_generator(std::uint32_t seed) noexcept : m_state(seed * 2654435761u + 1) {}
+
+        std::string generate(std::size_t size)
+        {
+          static const char* const words[] = {"archive", "buffer", "stream", "physfs", "mount", "device", "entry", "zip", "texture", "shader",
+                                              "level",   "config", "load",   "read",   "seek",  "file",   "path",  "dir", "index",   "data"};
+          const std::size_t word_count = sizeof(words) / sizeof(words[0]);
+
+          std::string text;
+          text.reserve(size + 16);
+          std::size_t words_in_line = 0;
+          while (text.size() < size)
+          {
+            text += words[next() % word_count];
+            if (++words_in_line > 4 + next() % 8)
+            {
+              text += '\n';
+              words_in_line = 0;
+            }
+            else
+            {
+              text += ' ';
+            }
+            // a bit of noise keeps the deflated data from becoming trivial
+            if (next() % 16 == 0)
+            {
+              text += static_cast<char>('0' + next() % 10);
+            }
+          }
+          text.resize(size);
+          return text;
+        }
+
+      private:
+        inline std::uint32_t next() noexcept
+        {
+          m_state ^= m_state << 13;
+          m_state ^= m_state >> 17;
+          m_state ^= m_state << 5;
+          return m_state;
+        }
+
+        std::uint32_t m_state;
+      };
+
+      std::uint32_t crc32_of(const std::string& data)
+      {
+        static const std::array<std::uint32_t, 256> table = [] {
+          std::array<std::uint32_t, 256> values{};
+          for (std::uint32_t i = 0; i < 256; ++i)
+          {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+              c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            values[i] = c;
+          }
+          return values;
+        }();
+
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (unsigned char c : data)
+        {
+          crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+      }
+
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+      std::string deflate_raw(const std::string& data)
+      {
+        // ends the stream also if allocating the output throws
+        detail::pack::deflater deflater(Z_DEFAULT_COMPRESSION);
+        z_stream& stream = deflater.stream();
+
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+        stream.avail_out = static_cast<uInt>(compressed.size());
+
+        const int status = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        if (status != Z_STREAM_END)
+        {
+          throw exception("deflate of benchmark data failed");
+        }
+        return compressed;
+      }
+#endif
+
+      /// Writes a minimal zip archive (no zip64, no extra fields) through the physfs write dir.
+      class zip_writer
+      {
+      public:
+        zip_writer(const std::string& filename, bool deflated)
+            : m_file(filename, access_mode::write), m_deflated(deflated), m_offset(0), m_directory(), m_count(0)
+        {
+        }
+
+        void add(const std::string& name, const std::string& data)
+        {
+          std::string payload = data;
+          std::uint16_t method = 0;
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+          if (m_deflated)
+          {
+            payload = deflate_raw(data);
+            method = 8;
+          }
+#endif
+          const std::uint32_t crc = crc32_of(data);
+          const std::uint32_t offset = m_offset;
+
+          std::string header;
+          put32(header, 0x04034b50);
+          put_common(header, method, crc, payload.size(), data.size(), name.size());
+          put16(header, 0); // extra field length
+          header += name;
+          emit(header);
+          emit(payload);
+
+          put32(m_directory, 0x02014b50);
+          put16(m_directory, 20); // version made by
+          put_common(m_directory, method, crc, payload.size(), data.size(), name.size());
+          put16(m_directory, 0); // extra field length
+          put16(m_directory, 0); // comment length
+          put16(m_directory, 0); // disk number
+          put16(m_directory, 0); // internal attributes
+          put32(m_directory, 0); // external attributes
+          put32(m_directory, offset);
+          m_directory += name;
+          ++m_count;
+        }
+
+        void finish()
+        {
+          const std::uint32_t directory_offset = m_offset;
+          std::string end;
+          put32(end, 0x06054b50);
+          put16(end, 0);
+          put16(end, 0);
+          put16(end, static_cast<std::uint16_t>(m_count));
+          put16(end, static_cast<std::uint16_t>(m_count));
+          put32(end, static_cast<std::uint32_t>(m_directory.size()));
+          put32(end, directory_offset);
+          put16(end, 0);
+
+          emit(m_directory);
+          emit(end);
+          m_file.close();
+        }
+
+      private:
+        static void put16(std::string& out, std::uint16_t value)
+        {
+          out += static_cast<char>(value & 0xFF);
+          out += static_cast<char>((value >> 8) & 0xFF);
+        }
+
+        static void put32(std::string& out, std::uint32_t value)
+        {
+          put16(out, static_cast<std::uint16_t>(value & 0xFFFF));
+          put16(out, static_cast<std::uint16_t>(value >> 16));
+        }
+
+        static void put_common(std::string& out, std::uint16_t method, std::uint32_t crc, std::size_t compressed, std::size_t size, std::size_t name_length)
+        {
+          put16(out, 20);     // version needed
+          put16(out, 0);      // flags
+          put16(out, method); // compression method
+          put16(out, 0);      // modification time
+          put16(out, 0x21);   // modification date (1980-01-01)
+          put32(out, crc);
+          put32(out, static_cast<std::uint32_t>(compressed));
+          put32(out, static_cast<std::uint32_t>(size));
+          put16(out, static_cast<std::uint16_t>(name_length));
+        }
+
+        void emit(const std::string& data)
+        {
+          m_file.write(data.data(), static_cast<std::streamsize>(data.size()));
+          PHYSFS_CXX_CHECK(m_file.good());
+          m_offset += static_cast<std::uint32_t>(data.size());
+        }
+
+        physfs::ofstream m_file;
+        bool m_deflated;
+        std::uint32_t m_offset;
+        std::string m_directory;
+        std::size_t m_count;
+      };
+
+      std::string layout_stamp(const data_layout& layout)
+      {
+        std::ostringstream stamp;
+        stamp << "v2 " << layout.small_files << " " << layout.small_size << " " << layout.large_files << " " << layout.large_size << " "
+              << layout.search_paths;
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+        stamp << " zlib";
+#endif
+        return stamp.str();
+      }
+
+      void write_file(const std::string& filename, const std::string& data)
+      {
+        physfs::ofstream out(filename);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        PHYSFS_CXX_CHECK(out.good());
+      }
+
+    } // namespace
+
+    std::string data_layout::small_file(std::size_t index)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "small/f%05u.txt", static_cast<unsigned>(index));
+      return name;
+    }
+
+    std::string data_layout::large_file(std::size_t index)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "large/l%02u.txt", static_cast<unsigned>(index));
+      return name;
+    }
+
+    std::string data_layout::search_path_name(std::size_t index)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "paths/p%04u", static_cast<unsigned>(index));
+      return name;
+    }
+
+    std::string data_layout::search_path_file(std::size_t index)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "marker_%04u.txt", static_cast<unsigned>(index));
+      return name;
+    }
+
+    std::vector<std::string> archive_sources()
+    {
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+      return {"stored", "deflated"};
+#else
+      return {"stored"};
+#endif
+    }
+
+    std::vector<std::string> pack_sources()
+    {
+#ifdef PHYSFS_CXX_BENCH_HAVE_ZLIB
+      return {"pack_stored", "pack_compressed"};
+#else
+      return {"pack_stored"};
+#endif
+    }
+
+    std::vector<std::string> sources()
+    {
+      auto names = archive_sources();
+      names.insert(names.begin(), directory_source);
+      return names;
+    }
+
+    void generate(const data_layout& layout)
+    {
+      const std::string stamp_file(layout.root + "/stamp.txt");
+      const std::string stamp = layout_stamp(layout);
+      {
+        std::ifstream existing(stamp_file);
+        std::string content;
+        if (std::getline(existing, content) && content == stamp)
+        {
+          return;
+        }
+      }
+
+      std::cerr << "generating benchmark data in " << layout.root << std::endl;
+      set_write_dir(layout.root);
+
+      make_directory("tree/small");
+      make_directory("tree/large");
+
+      std::vector<std::pair<std::string, std::string>> files;
+      for (std::size_t i = 0; i < layout.small_files; ++i)
+      {
+        text_generator generator(static_cast<std::uint32_t>(i));
+        // vary the size between half and one and a half of the requested size
+        files.emplace_back(data_layout::small_file(i), generator.generate(layout.small_size / 2 + (i * 7919) % (layout.small_size + 1)));
+      }
+      for (std::size_t i = 0; i < layout.large_files; ++i)
+      {
+        text_generator generator(static_cast<std::uint32_t>(100000 + i));
+        files.emplace_back(data_layout::large_file(i), generator.generate(layout.large_size));
+      }
+
+      for (const auto& file : files)
+      {
+        write_file("tree/" + file.first, file.second);
+      }
+
+      for (const auto& source : archive_sources())
+      {
+        zip_writer writer(source + ".zip", source != "stored");
+        for (const auto& file : files)
+        {
+          writer.add(file.first, file.second);
+        }
+        writer.finish();
+      }
+
+      {
+        const std::string input("pack_input");
+        mount(layout.tree_dir(), input);
+        for (const auto& source : pack_sources())
+        {
+          int compression = pack_writer::default_compression;
+          if (source == "pack_stored")
+          {
+            compression = 0;
+          }
+          pack_writer writer(compression);
+          writer.add_tree(input);
+          std::ofstream out(layout.pack(source), std::ios::binary);
+          writer.write(out);
+        }
+        unmount(layout.tree_dir());
+      }
+
+      for (std::size_t i = 0; i < layout.search_paths; ++i)
+      {
+        make_directory(data_layout::search_path_name(i));
+        write_file(data_layout::search_path_name(i) + "/" + data_layout::search_path_file(i), "marker\n");
+      }
+
+      write_file("stamp.txt", stamp + "\n");
+      disable_writing();
+    }
+
+    void mount_sources(const data_layout& layout)
+    {
+      mount(layout.tree_dir(), directory_source);
+      for (const auto& source : archive_sources())
+      {
+        mount(layout.archive(source), source);
+      }
+    }
+
+    void unmount_sources(const data_layout& layout)
+    {
+      unmount(layout.tree_dir());
+      for (const auto& source : archive_sources())
+      {
+        unmount(layout.archive(source));
+      }
+    }
+
+  } // namespace bench
+} // namespace physfs
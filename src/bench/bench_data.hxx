@@ -0,0 +1,58 @@
+#ifndef PHYSFS_CXX_BENCH_DATA_HXX
+#define PHYSFS_CXX_BENCH_DATA_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace physfs
+{
+  namespace bench
+  {
+    /// size of the random reads in the large files, smaller large files are rejected
+    static const std::size_t random_read_size = 4 * 1024;
+
+    /// Describes the generated benchmark data below a real directory.
+    ///
+    /// The directory tree "tree" holds many small and a few large text files, the same content is
+    /// also packed into "stored.zip" and (if zlib is available) "deflated.zip", and into the packs
+    /// "pack_stored.pxp" and "pack_compressed.pxp". Additionally "paths" holds a number of tiny
+    /// directories used to grow the search path.
+    struct data_layout
+    {
+      std::string root;
+      std::size_t small_files;
+      std::size_t small_size;
+      std::size_t large_files;
+      std::size_t large_size;
+      std::size_t search_paths;
+
+      inline std::string tree_dir() const { return root + "/tree"; }
+      inline std::string archive(const std::string& source) const { return root + "/" + source + ".zip"; }
+      inline std::string pack(const std::string& source) const { return root + "/" + source + ".pxp"; }
+      inline std::string search_path(std::size_t index) const { return root + "/" + search_path_name(index); }
+
+      static std::string small_file(std::size_t index);
+      static std::string large_file(std::size_t index);
+      static std::string search_path_name(std::size_t index);
+      static std::string search_path_file(std::size_t index);
+    };
+
+    /// names of the generated sources, they are mounted at the mount point with the same name
+    std::vector<std::string> sources();
+    /// names of the generated archives
+    std::vector<std::string> archive_sources();
+    /// names of the generated packs, they need the registered pack archiver
+    std::vector<std::string> pack_sources();
+
+    /// Creates the benchmark data unless data with the same layout already exists. Needs an initialized physfs.
+    void generate(const data_layout& layout);
+
+    /// Mounts the directory tree and all archives at their source name.
+    void mount_sources(const data_layout& layout);
+    void unmount_sources(const data_layout& layout);
+
+  } // namespace bench
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_BENCH_DATA_HXX*/
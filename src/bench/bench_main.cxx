@@ -0,0 +1,143 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  void print_usage(const char* program)
+  {
+    std::cerr << "usage: " << program << " [options]\n"
+              << "  --data-dir <dir>      existing directory for the generated data (default: " << BENCH_DATA << ")\n"
+              << "  --repetitions <n>     repetitions per benchmark, the best run is reported (default: 5)\n"
+              << "  --filter <text>       only run benchmarks whose \"suite/name\" contains <text>\n"
+              << "  --format <format>     table, json or csv (default: table)\n"
+              << "  --output <file>       write the results to <file> instead of stdout\n"
+              << "  --scale <factor>      scale the size of the generated data (default: 1.0)\n";
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  using namespace physfs::bench;
+
+  std::string data_dir(BENCH_DATA);
+  std::size_t repetitions = 5;
+  std::string filter;
+  output_format format = output_format::table;
+  std::string output;
+  double scale = 1.0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool has_value = (i + 1 < argc);
+    if (std::strcmp(argv[i], "--data-dir") == 0 && has_value)
+    {
+      data_dir = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value)
+    {
+      repetitions = static_cast<std::size_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+    {
+      filter = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--format") == 0 && has_value)
+    {
+      const std::string value(argv[++i]);
+      if (value == "json")
+      {
+        format = output_format::json;
+      }
+      else if (value == "csv")
+      {
+        format = output_format::csv;
+      }
+      else if (value != "table")
+      {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+    else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+    {
+      output = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--scale") == 0 && has_value)
+    {
+      scale = std::strtod(argv[++i], nullptr);
+    }
+    else
+    {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (scale <= 0.0)
+  {
+    scale = 1.0;
+  }
+
+  data_layout layout{data_dir,
+                     static_cast<std::size_t>(2000 * scale),
+                     2048,
+                     3,
+                     static_cast<std::size_t>(8 * 1024 * 1024 * scale),
+                     256};
+  if (layout.large_size < random_read_size)
+  {
+    // the random reads need at least one full read in the large files
+    std::cerr << "--scale " << scale << " makes the large files smaller than " << random_read_size << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    runner bench_runner(repetitions, filter);
+    {
+      physfs::init_guard guard(argv[0]);
+      generate(layout);
+
+      std::cerr << "mount benchmarks" << std::endl;
+      run_mount_benchmarks(bench_runner, layout);
+
+      mount_sources(layout);
+      std::cerr << "core benchmarks" << std::endl;
+      run_core_benchmarks(bench_runner, layout);
+      std::cerr << "read benchmarks" << std::endl;
+      run_read_benchmarks(bench_runner, layout);
+      std::cerr << "loader benchmarks" << std::endl;
+      run_loader_benchmarks(bench_runner, layout);
+      unmount_sources(layout);
+
+      std::cerr << "pack benchmarks" << std::endl;
+      run_pack_benchmarks(bench_runner, layout);
+    }
+
+    // every allocator needs its own physfs session
+    std::cerr << "allocator benchmarks" << std::endl;
+    run_allocator_benchmarks(bench_runner, layout, argv[0]);
+
+    if (output.empty())
+    {
+      bench_runner.write(std::cout, format);
+    }
+    else
+    {
+      std::ofstream out(output);
+      bench_runner.write(out, format);
+    }
+  }
+  catch (physfs::exception& e)
+  {
+    std::cerr << "benchmark failed: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
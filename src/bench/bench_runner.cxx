@@ -0,0 +1,110 @@
+#include "bench_runner.hxx"
+
+#include <iomanip>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      std::string escape_json(const std::string& value)
+      {
+        std::string escaped;
+        for (char c : value)
+        {
+          if (c == '"' || c == '\\')
+          {
+            escaped += '\\';
+          }
+          escaped += c;
+        }
+        return escaped;
+      }
+    } // namespace
+
+    void runner::run(const std::string& suite, const std::string& name, const std::string& source, const benchmark_function& fn)
+    {
+      if (!enabled(suite, name))
+      {
+        return;
+      }
+
+      std::vector<double> timings;
+      timings.reserve(m_repetitions);
+
+      sample work{0, 0};
+      for (std::size_t i = 0; i < m_repetitions; ++i)
+      {
+        const auto start = std::chrono::steady_clock::now();
+        work = fn();
+        const auto stop = std::chrono::steady_clock::now();
+        timings.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+      }
+
+      std::sort(timings.begin(), timings.end());
+      m_results.push_back(result{suite, name, source, work.operations, work.bytes, timings.front(), timings[timings.size() / 2]});
+
+      const result& last = m_results.back();
+      std::cerr << "  " << suite << "/" << name << " [" << source << "] " << std::fixed << std::setprecision(1) << last.ns_per_operation() << " ns/op";
+      if (last.bytes != 0)
+      {
+        std::cerr << ", " << last.mb_per_second() << " MB/s";
+      }
+      std::cerr << std::endl;
+    }
+
+    void runner::write(std::ostream& out, output_format format) const
+    {
+      switch (format)
+      {
+        case output_format::table:
+          write_table(out);
+          break;
+        case output_format::json:
+          write_json(out);
+          break;
+        case output_format::csv:
+          write_csv(out);
+          break;
+      }
+    }
+
+    void runner::write_table(std::ostream& out) const
+    {
+      out << std::left << std::setw(12) << "suite" << std::setw(44) << "name" << std::setw(14) << "source" << std::right << std::setw(14) << "ns/op"
+          << std::setw(12) << "MB/s" << "\n";
+      for (const auto& entry : m_results)
+      {
+        out << std::left << std::setw(12) << entry.suite << std::setw(44) << entry.name << std::setw(14) << entry.source << std::right << std::fixed
+            << std::setprecision(1) << std::setw(14) << entry.ns_per_operation() << std::setw(12) << entry.mb_per_second() << "\n";
+      }
+    }
+
+    void runner::write_json(std::ostream& out) const
+    {
+      out << "[\n";
+      for (std::size_t i = 0; i < m_results.size(); ++i)
+      {
+        const auto& entry = m_results[i];
+        out << "  {\"suite\": \"" << escape_json(entry.suite) << "\", \"name\": \"" << escape_json(entry.name) << "\", \"source\": \""
+            << escape_json(entry.source) << "\", \"operations\": " << entry.operations << ", \"bytes\": " << entry.bytes << std::fixed
+            << std::setprecision(1) << ", \"best_ns\": " << entry.best_ns << ", \"median_ns\": " << entry.median_ns
+            << ", \"ns_per_op\": " << entry.ns_per_operation() << ", \"mb_per_s\": " << entry.mb_per_second() << "}"
+            << ((i + 1 < m_results.size()) ? ",\n" : "\n");
+      }
+      out << "]\n";
+    }
+
+    void runner::write_csv(std::ostream& out) const
+    {
+      out << "suite,name,source,operations,bytes,best_ns,median_ns,ns_per_op,mb_per_s\n";
+      for (const auto& entry : m_results)
+      {
+        out << entry.suite << "," << entry.name << "," << entry.source << "," << entry.operations << "," << entry.bytes << "," << std::fixed
+            << std::setprecision(1) << entry.best_ns << "," << entry.median_ns << "," << entry.ns_per_operation() << "," << entry.mb_per_second() << "\n";
+      }
+    }
+
+  } // namespace bench
+} // namespace physfs
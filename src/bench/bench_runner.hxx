@@ -0,0 +1,76 @@
+#ifndef PHYSFS_CXX_BENCH_RUNNER_HXX
+#define PHYSFS_CXX_BENCH_RUNNER_HXX
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace physfs
+{
+  namespace bench
+  {
+    /// work done by a single repetition of a benchmark
+    struct sample
+    {
+      std::uint64_t operations;
+      std::uint64_t bytes;
+    };
+
+    struct result
+    {
+      std::string suite;
+      std::string name;
+      std::string source;
+      std::uint64_t operations;
+      std::uint64_t bytes;
+      double best_ns;
+      double median_ns;
+
+      inline double ns_per_operation() const noexcept { return (operations != 0) ? best_ns / static_cast<double>(operations) : 0.0; }
+      inline double mb_per_second() const noexcept { return (best_ns > 0.0) ? (static_cast<double>(bytes) * 1.0e3) / best_ns : 0.0; }
+    };
+
+    enum class output_format
+    {
+      table,
+      json,
+      csv
+    };
+
+    class runner
+    {
+    public:
+      typedef std::function<sample()> benchmark_function;
+
+      runner(std::size_t repetitions, std::string filter) : m_repetitions(std::max<std::size_t>(repetitions, 1)), m_filter(std::move(filter)), m_results() {}
+
+      /// Runs \p fn repeatedly and records the best and the median wall time. Set up work belongs outside of \p fn.
+      void run(const std::string& suite, const std::string& name, const std::string& source, const benchmark_function& fn);
+
+      inline bool enabled(const std::string& suite, const std::string& name) const
+      {
+        return m_filter.empty() || (suite + "/" + name).find(m_filter) != std::string::npos;
+      }
+
+      inline const std::vector<result>& results() const noexcept { return m_results; }
+
+      void write(std::ostream& out, output_format format) const;
+
+    private:
+      void write_table(std::ostream& out) const;
+      void write_json(std::ostream& out) const;
+      void write_csv(std::ostream& out) const;
+
+      std::size_t m_repetitions;
+      std::string m_filter;
+      std::vector<result> m_results;
+    };
+
+  } // namespace bench
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_BENCH_RUNNER_HXX*/
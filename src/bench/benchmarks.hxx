@@ -0,0 +1,27 @@
+#ifndef PHYSFS_CXX_BENCH_BENCHMARKS_HXX
+#define PHYSFS_CXX_BENCH_BENCHMARKS_HXX
+
+#include "bench_data.hxx"
+#include "bench_runner.hxx"
+
+namespace physfs
+{
+  namespace bench
+  {
+    /// sequential and random read throughput of file_device, physfs::ifstream and std::ifstream (needs mounted sources)
+    void run_read_benchmarks(runner& bench_runner, const data_layout& layout);
+    /// latency of enumerate_files, get_file_stat and exists with and without vfs_index (needs mounted sources)
+    void run_core_benchmarks(runner& bench_runner, const data_layout& layout);
+    /// mount and lookup cost for a growing number of search paths (needs an empty search path)
+    void run_mount_benchmarks(runner& bench_runner, const data_layout& layout);
+    /// parallel whole file loading with physfs::loader for a growing number of threads (needs mounted sources)
+    void run_loader_benchmarks(runner& bench_runner, const data_layout& layout);
+    /// open time, file lookup and random reads of the zip archives against the packs (mounts its own sources)
+    void run_pack_benchmarks(runner& bench_runner, const data_layout& layout);
+    /// physfs with its default allocator, the system_allocator and the pool_allocator (needs a deinitialized physfs)
+    void run_allocator_benchmarks(runner& bench_runner, const data_layout& layout, const char* argv0);
+
+  } // namespace bench
+} // namespace physfs
+
+#endif /*PHYSFS_CXX_BENCH_BENCHMARKS_HXX*/
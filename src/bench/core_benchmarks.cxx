@@ -0,0 +1,173 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      const std::size_t enumerate_repetitions = 20;
+      const std::size_t mount_repetitions = 20;
+      const std::size_t lookup_repetitions = 1000;
+    } // namespace
+
+    void run_core_benchmarks(runner& bench_runner, const data_layout& layout)
+    {
+      const std::string suite("core");
+
+      for (const auto& source : sources())
+      {
+        std::vector<std::string> files;
+        std::vector<std::string> missing;
+        for (std::size_t i = 0; i < layout.small_files; ++i)
+        {
+          files.push_back(source + "/" + data_layout::small_file(i));
+          missing.push_back(files.back() + ".missing");
+        }
+
+        const std::string small_dir(source + "/small");
+        bench_runner.run(suite, "enumerate_files", source, [&] {
+          sample work{0, 0};
+          for (std::size_t i = 0; i < enumerate_repetitions; ++i)
+          {
+            work.operations += (enumerate_files(small_dir).empty() ? 0 : 1);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "enumerate_callback", source, [&] {
+          sample work{0, 0};
+          for (std::size_t i = 0; i < enumerate_repetitions; ++i)
+          {
+            std::size_t entries = 0;
+            enumerate(small_dir, [&entries](const char*) {
+              ++entries;
+              return true;
+            });
+            work.operations += (entries == 0 ? 0 : 1);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "get_file_stat", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : files)
+          {
+            work.operations += (get_file_stat(filename).size() >= 0 ? 1 : 0);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "exists_hit", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : files)
+          {
+            work.operations += (exists(filename) ? 1 : 0);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "exists_miss", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : missing)
+          {
+            work.operations += (exists(filename) ? 0 : 1);
+          }
+          return work;
+        });
+
+        // the index is filled by the first repetition, the best run shows the cached lookups
+        vfs_index index;
+        bench_runner.run(suite, "vfs_index/get_file_stat", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : files)
+          {
+            work.operations += (index.stat(filename).size() >= 0 ? 1 : 0);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "vfs_index/exists_hit", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : files)
+          {
+            work.operations += (index.exists(filename) ? 1 : 0);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "vfs_index/exists_miss", source, [&] {
+          sample work{0, 0};
+          for (const auto& filename : missing)
+          {
+            work.operations += (index.exists(filename) ? 0 : 1);
+          }
+          return work;
+        });
+      }
+    }
+
+    void run_mount_benchmarks(runner& bench_runner, const data_layout& layout)
+    {
+      const std::string suite("mount");
+      const std::string archive(layout.archive("stored"));
+      const std::string directory(layout.tree_dir());
+      const std::string mount_point("extra");
+
+      std::size_t mounted = 0;
+      for (std::size_t paths = 1; paths <= layout.search_paths; paths *= 4)
+      {
+        for (; mounted < paths; ++mounted)
+        {
+          mount(layout.search_path(mounted));
+        }
+        const std::string source("paths=" + std::to_string(paths));
+        const std::string last_marker(data_layout::search_path_file(paths - 1));
+
+        bench_runner.run(suite, "mount_unmount_zip", source, [&] {
+          for (std::size_t i = 0; i < mount_repetitions; ++i)
+          {
+            mount(archive, mount_point);
+            unmount(archive);
+          }
+          return sample{mount_repetitions, 0};
+        });
+
+        bench_runner.run(suite, "mount_unmount_dir", source, [&] {
+          for (std::size_t i = 0; i < mount_repetitions; ++i)
+          {
+            mount(directory, mount_point);
+            unmount(directory);
+          }
+          return sample{mount_repetitions, 0};
+        });
+
+        bench_runner.run(suite, "exists_last_path", source, [&] {
+          sample work{0, 0};
+          for (std::size_t i = 0; i < lookup_repetitions; ++i)
+          {
+            work.operations += (exists(last_marker) ? 1 : 0);
+          }
+          return work;
+        });
+
+        bench_runner.run(suite, "exists_miss", source, [&] {
+          sample work{0, 0};
+          for (std::size_t i = 0; i < lookup_repetitions; ++i)
+          {
+            work.operations += (exists("missing/file.txt") ? 0 : 1);
+          }
+          return work;
+        });
+      }
+
+      for (std::size_t i = 0; i < mounted; ++i)
+      {
+        unmount(layout.search_path(i));
+      }
+    }
+
+  } // namespace bench
+} // namespace physfs
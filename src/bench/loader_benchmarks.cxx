@@ -0,0 +1,86 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+#include <thread>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      sample load_sequential(const std::vector<std::string>& files)
+      {
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          work.bytes += read_all_shared(filename).size();
+          ++work.operations;
+        }
+        return work;
+      }
+
+      sample load_parallel(const std::vector<std::string>& files, std::size_t threads)
+      {
+        loader batch_loader(threads);
+        auto results = batch_loader.load(files);
+
+        sample work{0, 0};
+        for (auto& result : results)
+        {
+          work.bytes += result.get().size();
+          ++work.operations;
+        }
+        return work;
+      }
+
+      std::vector<std::size_t> thread_counts()
+      {
+        // at least up to 8 threads to show where the curve flattens, even on small machines
+        const std::size_t limit = std::max<std::size_t>(loader::default_thread_count(), 8);
+        std::vector<std::size_t> counts;
+        for (std::size_t threads = 1; threads <= limit; threads *= 2)
+        {
+          counts.push_back(threads);
+        }
+        if (counts.back() != limit)
+        {
+          counts.push_back(limit);
+        }
+        return counts;
+      }
+
+    } // namespace
+
+    void run_loader_benchmarks(runner& bench_runner, const data_layout& layout)
+    {
+      const std::string suite("loader");
+
+      for (const auto& source : sources())
+      {
+        std::vector<std::string> small_files;
+        for (std::size_t i = 0; i < layout.small_files; ++i)
+        {
+          small_files.push_back(source + "/" + data_layout::small_file(i));
+        }
+        std::vector<std::string> large_files;
+        for (std::size_t i = 0; i < layout.large_files; ++i)
+        {
+          large_files.push_back(source + "/" + data_layout::large_file(i));
+        }
+
+        bench_runner.run(suite, "small_files/sequential", source, [&] { return load_sequential(small_files); });
+        bench_runner.run(suite, "large_files/sequential", source, [&] { return load_sequential(large_files); });
+
+        for (auto threads : thread_counts())
+        {
+          const std::string suffix("/threads=" + std::to_string(threads));
+          bench_runner.run(suite, "small_files" + suffix, source, [&] { return load_parallel(small_files, threads); });
+          bench_runner.run(suite, "large_files" + suffix, source, [&] { return load_parallel(large_files, threads); });
+        }
+      }
+    }
+
+  } // namespace bench
+} // namespace physfs
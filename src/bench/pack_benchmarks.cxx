@@ -0,0 +1,130 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+#include <random>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      const std::size_t open_count = 20;
+      const std::size_t random_read_count = 2000;
+
+      struct container
+      {
+        std::string source;
+        std::string filename;
+      };
+
+      sample open_close(const std::string& filename, const std::string& mount_point)
+      {
+        sample work{0, 0};
+        for (std::size_t i = 0; i < open_count; ++i)
+        {
+          mount(filename, mount_point);
+          unmount(filename);
+          ++work.operations;
+        }
+        return work;
+      }
+
+      sample open_files(const std::vector<std::string>& files)
+      {
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          file_device device(filename, access_mode::read);
+          ++work.operations;
+        }
+        return work;
+      }
+
+      sample random_reads(const std::vector<std::string>& files, const std::vector<std::uint64_t>& offsets)
+      {
+        std::vector<char> chunk(random_read_size);
+        std::vector<std::unique_ptr<file_device>> devices;
+        for (const auto& filename : files)
+        {
+          devices.emplace_back(new file_device(filename, access_mode::read));
+        }
+
+        sample work{0, 0};
+        for (std::size_t i = 0; i < offsets.size(); ++i)
+        {
+          file_device& device = *devices[i % devices.size()];
+          device.seek(offsets[i]);
+          work.bytes += static_cast<std::uint64_t>(device.read(chunk.data(), chunk.size()));
+          ++work.operations;
+        }
+        return work;
+      }
+
+      template <typename Read>
+      sample read_files(const std::vector<std::string>& files, Read read)
+      {
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          work.bytes += read(filename).size();
+          ++work.operations;
+        }
+        return work;
+      }
+
+    } // namespace
+
+    void run_pack_benchmarks(runner& bench_runner, const data_layout& layout)
+    {
+      const std::string suite("pack");
+      const auto archiver = register_pack_archiver();
+
+      std::vector<container> containers;
+      for (const auto& source : archive_sources())
+      {
+        containers.push_back(container{source, layout.archive(source)});
+      }
+      for (const auto& source : pack_sources())
+      {
+        containers.push_back(container{source, layout.pack(source)});
+      }
+
+      // the same random offsets for every container
+      std::vector<std::uint64_t> offsets;
+      {
+        std::mt19937_64 generator(42);
+        std::uniform_int_distribution<std::uint64_t> distribution(0, layout.large_size - random_read_size);
+        for (std::size_t i = 0; i < random_read_count; ++i)
+        {
+          offsets.push_back(distribution(generator));
+        }
+      }
+
+      for (const auto& item : containers)
+      {
+        bench_runner.run(suite, "open_close", item.source, [&] { return open_close(item.filename, item.source); });
+
+        mount(item.filename, item.source);
+        std::vector<std::string> small_files;
+        for (std::size_t i = 0; i < layout.small_files; ++i)
+        {
+          small_files.push_back(item.source + "/" + data_layout::small_file(i));
+        }
+        std::vector<std::string> large_files;
+        for (std::size_t i = 0; i < layout.large_files; ++i)
+        {
+          large_files.push_back(item.source + "/" + data_layout::large_file(i));
+        }
+
+        bench_runner.run(suite, "open_small_files", item.source, [&] { return open_files(small_files); });
+        bench_runner.run(suite, "random_4k", item.source, [&] { return random_reads(large_files, offsets); });
+        bench_runner.run(suite, "read_small_files/read_all_shared", item.source, [&] { return read_files(small_files, &read_all_shared); });
+        bench_runner.run(suite, "read_small_files/read_all_mapped", item.source, [&] { return read_files(small_files, &read_all_mapped); });
+        unmount(item.filename);
+      }
+    }
+
+  } // namespace bench
+} // namespace physfs
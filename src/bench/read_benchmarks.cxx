@@ -0,0 +1,169 @@
+#include "benchmarks.hxx"
+
+#include <physfs_cxx/physfs.hxx>
+
+#include <fstream>
+#include <random>
+
+namespace physfs
+{
+  namespace bench
+  {
+    namespace
+    {
+      const std::size_t chunk_size = 64 * 1024;
+      const std::size_t random_read_count = 2000;
+
+      inline void open_stream(physfs::ifstream& in, const std::string& filename) { in.open(filename); }
+      inline void open_stream(std::ifstream& in, const std::string& filename) { in.open(filename, std::ios::binary); }
+
+      sample read_with_device(const std::vector<std::string>& files)
+      {
+        std::vector<char> chunk(chunk_size);
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          file_device device(filename, access_mode::read);
+          std::int64_t count = 0;
+          while ((count = device.read(chunk.data(), chunk.size())) > 0)
+          {
+            work.bytes += static_cast<std::uint64_t>(count);
+          }
+          ++work.operations;
+        }
+        return work;
+      }
+
+      template <typename Stream>
+      sample read_with_stream(const std::vector<std::string>& files)
+      {
+        std::vector<char> chunk(chunk_size);
+        sample work{0, 0};
+        for (const auto& filename : files)
+        {
+          Stream in;
+          open_stream(in, filename);
+          while (in.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || in.gcount() > 0)
+          {
+            work.bytes += static_cast<std::uint64_t>(in.gcount());
+          }
+          ++work.operations;
+        }
+        return work;
+      }
+
+      template <typename Stream>
+      sample read_lines(const std::vector<std::string>& files)
+      {
+        sample work{0, 0};
+        std::string line;
+        for (const auto& filename : files)
+        {
+          Stream in;
+          open_stream(in, filename);
+          while (std::getline(in, line))
+          {
+            work.bytes += line.size() + 1;
+            ++work.operations;
+          }
+        }
+        return work;
+      }
+
+      sample random_read_with_device(const std::string& filename, const std::vector<std::uint64_t>& offsets)
+      {
+        std::vector<char> chunk(random_read_size);
+        file_device device(filename, access_mode::read);
+        sample work{0, 0};
+        for (auto offset : offsets)
+        {
+          device.seek(offset);
+          work.bytes += static_cast<std::uint64_t>(device.read(chunk.data(), chunk.size()));
+          ++work.operations;
+        }
+        return work;
+      }
+
+      template <typename Stream>
+      sample random_read_with_stream(const std::string& filename, const std::vector<std::uint64_t>& offsets)
+      {
+        std::vector<char> chunk(random_read_size);
+        Stream in;
+        open_stream(in, filename);
+        sample work{0, 0};
+        for (auto offset : offsets)
+        {
+          in.seekg(static_cast<std::streamoff>(offset));
+          in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+          work.bytes += static_cast<std::uint64_t>(in.gcount());
+          ++work.operations;
+        }
+        return work;
+      }
+
+      std::vector<std::string> prefixed(const std::string& prefix, const std::vector<std::string>& names)
+      {
+        std::vector<std::string> result;
+        result.reserve(names.size());
+        for (const auto& name : names)
+        {
+          result.push_back(prefix + "/" + name);
+        }
+        return result;
+      }
+
+    } // namespace
+
+    void run_read_benchmarks(runner& bench_runner, const data_layout& layout)
+    {
+      const std::string suite("read");
+
+      std::vector<std::string> small_files;
+      for (std::size_t i = 0; i < layout.small_files; ++i)
+      {
+        small_files.push_back(data_layout::small_file(i));
+      }
+      std::vector<std::string> large_files;
+      for (std::size_t i = 0; i < layout.large_files; ++i)
+      {
+        large_files.push_back(data_layout::large_file(i));
+      }
+
+      // the same random offsets for every source
+      std::vector<std::uint64_t> offsets;
+      {
+        std::mt19937_64 generator(42);
+        std::uniform_int_distribution<std::uint64_t> distribution(0, layout.large_size - random_read_size);
+        for (std::size_t i = 0; i < random_read_count; ++i)
+        {
+          offsets.push_back(distribution(generator));
+        }
+      }
+
+      for (const auto& source : sources())
+      {
+        const auto large = prefixed(source, large_files);
+        const auto small = prefixed(source, small_files);
+
+        bench_runner.run(suite, "large_sequential/file_device", source, [&] { return read_with_device(large); });
+        bench_runner.run(suite, "large_sequential/ifstream_read", source, [&] { return read_with_stream<physfs::ifstream>(large); });
+        bench_runner.run(suite, "large_sequential/ifstream_getline", source, [&] { return read_lines<physfs::ifstream>(large); });
+        bench_runner.run(suite, "small_files/file_device", source, [&] { return read_with_device(small); });
+        bench_runner.run(suite, "small_files/ifstream_read", source, [&] { return read_with_stream<physfs::ifstream>(small); });
+        bench_runner.run(suite, "random_4k/file_device", source, [&] { return random_read_with_device(large.front(), offsets); });
+        bench_runner.run(suite, "random_4k/ifstream_read", source, [&] { return random_read_with_stream<physfs::ifstream>(large.front(), offsets); });
+      }
+
+      // baseline without physfs on the real directory tree
+      const std::string native("native");
+      const auto large = prefixed(layout.tree_dir(), large_files);
+      const auto small = prefixed(layout.tree_dir(), small_files);
+
+      bench_runner.run(suite, "large_sequential/std_ifstream_read", native, [&] { return read_with_stream<std::ifstream>(large); });
+      bench_runner.run(suite, "large_sequential/std_ifstream_getline", native, [&] { return read_lines<std::ifstream>(large); });
+      bench_runner.run(suite, "small_files/std_ifstream_read", native, [&] { return read_with_stream<std::ifstream>(small); });
+      bench_runner.run(suite, "random_4k/std_ifstream_read", native, [&] { return random_read_with_stream<std::ifstream>(large.front(), offsets); });
+    }
+
+  } // namespace bench
+} // namespace physfs
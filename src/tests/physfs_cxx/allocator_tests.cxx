@@ -0,0 +1,122 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+#include <thread>
+
+TEST_CASE("testing the allocators for physfs", "[physfs]")
+{
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+
+  SECTION("test size classes")
+  {
+    REQUIRE(physfs::size_class(1) == 0);
+    REQUIRE(physfs::size_class(16) == 0);
+    REQUIRE(physfs::size_class(17) == 1);
+    REQUIRE(physfs::size_class(4096) == physfs::size_class_count - 2);
+    REQUIRE(physfs::size_class(4097) == physfs::size_class_count - 1);
+  }
+
+  SECTION("test the pool allocator from several threads")
+  {
+    physfs::pool_allocator pool;
+
+    auto work = [&pool]() {
+      std::vector<std::pair<char*, std::size_t>> blocks;
+      for (std::size_t i = 0; i < 2000; ++i)
+      {
+        const std::size_t size = 1 + (i * 37) % 6000;
+        auto* block = static_cast<char*>(pool.allocate(size));
+        std::memset(block, static_cast<int>(i), size);
+        blocks.emplace_back(block, size);
+        if (i % 3 == 0)
+        {
+          pool.deallocate(blocks.front().first, blocks.front().second);
+          blocks.erase(blocks.begin());
+        }
+      }
+      for (auto& block : blocks)
+      {
+        pool.deallocate(block.first, block.second);
+      }
+    };
+
+    std::thread first(work);
+    std::thread second(work);
+    work();
+    first.join();
+    second.join();
+
+    auto* block = static_cast<char*>(pool.allocate(20));
+    std::memcpy(block, "physfs", 7);
+    block = static_cast<char*>(pool.reallocate(block, 20, 5000));
+    REQUIRE(std::string(block) == "physfs");
+    pool.deallocate(block, 5000);
+  }
+
+  SECTION("test statistics of a physfs session")
+  {
+    physfs::pool_allocator pool;
+    {
+      physfs::init_guard guard(nullptr, pool);
+      REQUIRE(physfs::get_allocator() == &pool);
+      REQUIRE_THROWS_AS(physfs::set_allocator(nullptr), physfs::exception);
+
+      const auto before_mount = pool.stats().live_bytes;
+      physfs::mount(target_archive, archiv_mount_point);
+      const auto mounted = pool.stats().live_bytes;
+      REQUIRE(mounted > before_mount);
+
+      REQUIRE(physfs::read_all(archiv_mount_point + "/themeinfo.txt").size() == 19);
+      REQUIRE(physfs::enumerate_files(archiv_mount_point).size() == 6);
+
+      physfs::unmount(target_archive);
+      REQUIRE(pool.stats().live_bytes < mounted);
+    }
+    REQUIRE(physfs::get_allocator() == nullptr);
+
+    const auto stats = pool.stats();
+    REQUIRE(stats.live_bytes == 0);
+    REQUIRE(stats.peak_bytes > 0);
+    REQUIRE(stats.allocations == stats.deallocations);
+
+    std::uint64_t per_class = 0;
+    for (auto count : stats.class_allocations)
+    {
+      per_class += count;
+    }
+    REQUIRE(per_class == stats.allocations);
+  }
+
+  SECTION("test scoped arena allocations")
+  {
+    physfs::system_allocator system;
+    physfs::arena_allocator arena;
+    REQUIRE_THROWS_AS(physfs::allocator_scope{arena}, physfs::exception);
+
+    physfs::init_guard guard(nullptr, system);
+
+    {
+      physfs::allocator_scope scope(arena);
+      physfs::mount(target_archive, archiv_mount_point);
+      REQUIRE(physfs::exists(archiv_mount_point + "/themeinfo.txt"));
+      physfs::unmount(target_archive);
+    }
+    REQUIRE(arena.stats().allocations > 0);
+    REQUIRE(arena.reserved_bytes() > 0);
+
+    const auto system_allocations = system.stats().allocations;
+    physfs::mount(target_archive, archiv_mount_point);
+    REQUIRE(system.stats().allocations > system_allocations);
+    physfs::unmount(target_archive);
+
+    {
+      // blocks which physfs keeps beyond the scope stay valid after the arena is gone
+      physfs::arena_allocator short_lived;
+      physfs::allocator_scope scope(short_lived);
+      physfs::mount(target_archive, archiv_mount_point);
+    }
+    physfs::unmount(target_archive);
+  }
+}
@@ -73,4 +73,70 @@ TEST_CASE("testing wrapper for physfs", "[physfs]")
 
     physfs::unmount(target_archive);
   }
-}
\ No newline at end of file
+
+  SECTION("test whole file loading")
+  {
+    physfs::init_guard guard;
+    const std::string mount_point("zip_archiv");
+    const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+    physfs::mount(target_archive, mount_point);
+
+    const std::string theme_info_file(mount_point + "/themeinfo.txt");
+
+    auto content = physfs::read_all<std::string>(theme_info_file);
+    REQUIRE(content.size() == 19);
+    REQUIRE_THAT(content, Catch::Matchers::StartsWith("Ilya Baranovsky"));
+
+    std::vector<char> buffer(100, 'x');
+    physfs::read_all(theme_info_file, buffer);
+    REQUIRE(std::string(buffer.begin(), buffer.end()) == content);
+
+    char storage[32];
+    REQUIRE(physfs::read_all(theme_info_file, storage, sizeof(storage)) == 19);
+    REQUIRE(std::string(storage, 19) == content);
+
+    char too_small[4];
+    REQUIRE_THROWS_AS(physfs::read_all(theme_info_file, too_small, sizeof(too_small)), physfs::exception);
+
+    auto data = physfs::read_all_shared(theme_info_file);
+    REQUIRE(std::string(data.begin(), data.end()) == content);
+    {
+      auto copy = data;
+      REQUIRE(copy.data() == data.data());
+      REQUIRE(data.use_count() == 2);
+    }
+    REQUIRE(data.use_count() == 1);
+
+    physfs::unmount(target_archive);
+  }
+
+  SECTION("test mounting of archives in memory")
+  {
+    physfs::init_guard guard;
+    const std::string data_mount_point("test_data");
+    physfs::mount(TEST_DATA, data_mount_point);
+
+    const std::string archive_file(data_mount_point + "/test_archive.zip");
+    auto archive = physfs::read_all_shared(archive_file);
+
+    {
+      const std::string mount_point("memory");
+      auto memory_guard = physfs::mount_memory(archive, "memory_archive.zip", mount_point);
+      REQUIRE(memory_guard.is_mounted());
+      REQUIRE(archive.use_count() > 1);
+      REQUIRE(physfs::exists(mount_point + "/themeinfo.txt"));
+      REQUIRE(physfs::read_all<std::string>(mount_point + "/themeinfo.txt").size() == 19);
+    }
+    REQUIRE_FALSE(physfs::exists("memory/themeinfo.txt"));
+    REQUIRE(archive.use_count() == 1);
+
+    {
+      const std::string mount_point("handle");
+      physfs::file_device device(archive_file, physfs::access_mode::read);
+      auto handle_guard = physfs::mount_handle(device, "handle_archive.zip", mount_point);
+      REQUIRE_FALSE(device.is_open());
+      REQUIRE(physfs::exists(mount_point + "/themeinfo.txt"));
+    }
+    REQUIRE_FALSE(physfs::exists("handle/themeinfo.txt"));
+  }
+}
@@ -0,0 +1,154 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE("testing the content cache for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  const std::string test_file(archiv_mount_point + "/themeinfo.txt");
+  physfs::mount(target_archive, archiv_mount_point);
+
+  SECTION("test hits, misses and evictions")
+  {
+    physfs::content_cache cache(3000);
+
+    const auto first = cache.get(test_file);
+    const auto second = cache.get(test_file);
+    REQUIRE(first.size() == 19);
+    REQUIRE(first.data() == second.data());
+
+    REQUIRE(cache.get(archiv_mount_point + "/wallpapers.txt").size() == 391);
+    REQUIRE(cache.get(archiv_mount_point + "/counters/quest.png").size() == 2313);
+    cache.get(test_file);
+    // larger than the whole cache
+    REQUIRE(cache.get(archiv_mount_point + "/fakebar.png").size() == 5885);
+    REQUIRE_THROWS_AS(cache.get(archiv_mount_point + "/missing.txt"), physfs::exception);
+
+    auto stats = cache.stats();
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 5);
+    REQUIRE(stats.entries == 3);
+    REQUIRE(stats.bytes == 19 + 391 + 2313);
+    REQUIRE(stats.evictions == 0);
+
+    // the least recently used entry goes first
+    cache.set_capacity(2400);
+    stats = cache.stats();
+    REQUIRE(stats.capacity == 2400);
+    REQUIRE(stats.entries == 2);
+    REQUIRE(stats.bytes == 19 + 2313);
+    REQUIRE(stats.evictions == 1);
+
+    cache.get(archiv_mount_point + "/wallpapers.txt");
+    REQUIRE(cache.stats().evictions == 2);
+    REQUIRE(cache.stats().bytes == 19 + 391);
+
+    cache.reset_stats();
+    cache.erase(test_file);
+    cache.get(test_file);
+    REQUIRE(cache.stats().misses == 1);
+    cache.clear();
+    REQUIRE(cache.stats().entries == 0);
+    REQUIRE(cache.stats().bytes == 0);
+  }
+
+  SECTION("test invalidation on mount changes")
+  {
+    physfs::content_cache cache;
+    const auto cached = cache.get(test_file);
+
+    // an unrelated mount keeps the entry
+    physfs::mount(TEST_DATA, std::string("test_data"));
+    REQUIRE(cache.get(test_file).data() == cached.data());
+    REQUIRE(cache.stats().invalidations == 0);
+    physfs::unmount(TEST_DATA);
+
+    physfs::unmount(target_archive);
+    physfs::mount(target_archive, archiv_mount_point);
+    const auto reloaded = cache.get(test_file);
+    REQUIRE(reloaded.data() != cached.data());
+    REQUIRE(std::string(reloaded.data(), reloaded.size()) == std::string(cached.data(), cached.size()));
+
+    const auto stats = cache.stats();
+    REQUIRE(stats.invalidations == 1);
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+  }
+
+  SECTION("test reading cached content through streams")
+  {
+    physfs::content_cache cache;
+
+    physfs::ifstream stream(test_file, cache.get(test_file));
+    REQUIRE(stream.is_open());
+    std::string line;
+    std::getline(stream, line);
+    REQUIRE(line == "Ilya Baranovsky\r");
+    stream.seekg(5);
+    std::getline(stream, line);
+    REQUIRE(line == "Baranovsky\r");
+
+    physfs::file_device device(test_file, cache.get(test_file));
+    REQUIRE(device.is_in_memory());
+    REQUIRE(device.native_handle() == nullptr);
+    REQUIRE(device.file_length() == 19);
+
+    char buffer[32];
+    device.seek(15);
+    REQUIRE(device.read(buffer, sizeof(buffer)) == 4);
+    REQUIRE(device.tell() == 19);
+    REQUIRE(device.eof());
+    REQUIRE_THROWS_AS(device.seek(20), physfs::exception);
+    REQUIRE_THROWS_AS(device.write(buffer, 1), physfs::exception);
+
+    device.close();
+    REQUIRE_FALSE(device.is_open());
+    REQUIRE(cache.stats().hits == 1);
+  }
+
+  SECTION("test concurrent access")
+  {
+    physfs::content_cache cache(1024);
+    // catch assertions aren't thread safe, the workers only count wrong results
+    std::atomic<int> failures(0);
+    auto work = [&]() {
+      for (int i = 0; i < 100; ++i)
+      {
+        try
+        {
+          if (cache.get(test_file).size() != 19 || cache.get(archiv_mount_point + "/wallpapers.txt").size() != 391)
+          {
+            ++failures;
+          }
+        }
+        catch (...)
+        {
+          ++failures;
+        }
+        if (i % 10 == 0)
+        {
+          cache.set_capacity(i % 20 == 0 ? 100 : 1024);
+        }
+      }
+    };
+
+    std::thread first(work);
+    std::thread second(work);
+    work();
+    first.join();
+    second.join();
+
+    REQUIRE(failures == 0);
+    const auto stats = cache.stats();
+    REQUIRE(stats.hits + stats.misses == 600);
+    REQUIRE(stats.bytes <= stats.capacity);
+  }
+
+  physfs::unmount(target_archive);
+}
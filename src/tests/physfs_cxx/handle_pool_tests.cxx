@@ -0,0 +1,148 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE("testing the handle pool for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  const std::string test_file(archiv_mount_point + "/themeinfo.txt");
+  const std::string other_file(archiv_mount_point + "/wallpapers.txt");
+  physfs::mount(target_archive, archiv_mount_point);
+
+  SECTION("test reusing handles")
+  {
+    physfs::handle_pool pool(2);
+
+    auto device = pool.acquire(test_file);
+    REQUIRE(device.is_open());
+    char buffer[32];
+    REQUIRE(device.read(buffer, sizeof(buffer)) == 19);
+    PHYSFS_File* handle = device.native_handle();
+    pool.release(std::move(device));
+    REQUIRE(pool.stats().idle == 1);
+
+    // reused handles start at the beginning again
+    auto reused = pool.acquire(test_file);
+    REQUIRE(reused.native_handle() == handle);
+    REQUIRE(reused.tell() == 0);
+    REQUIRE(reused.read(buffer, 4) == 4);
+    REQUIRE(std::string(buffer, 4) == "Ilya");
+    pool.release(std::move(reused));
+
+    REQUIRE_THROWS_AS(pool.acquire(archiv_mount_point + "/missing.txt"), physfs::exception);
+
+    auto stats = pool.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.idle == 1);
+
+    pool.clear();
+    REQUIRE(pool.stats().idle == 0);
+  }
+
+  SECTION("test eviction and foreign devices")
+  {
+    physfs::handle_pool pool(2);
+
+    auto first = pool.acquire(test_file);
+    auto second = pool.acquire(test_file);
+    auto third = pool.acquire(other_file);
+    pool.release(std::move(first));
+    pool.release(std::move(second));
+    pool.release(std::move(third));
+
+    auto stats = pool.stats();
+    REQUIRE(stats.idle == 2);
+    REQUIRE(stats.evictions == 1);
+
+    // devices which weren't acquired from the pool are closed
+    pool.release(physfs::file_device(test_file, physfs::access_mode::read));
+    REQUIRE(pool.stats().idle == 2);
+
+    // also if they got the handle address of a lent device which was never released
+    const std::string third_file(archiv_mount_point + "/counters/quest.png");
+    {
+      auto lent = pool.acquire(third_file);
+    }
+    pool.release(physfs::file_device(third_file, physfs::access_mode::read));
+    REQUIRE(pool.stats().idle == 2);
+
+    pool.set_capacity(0);
+    stats = pool.stats();
+    REQUIRE(stats.idle == 0);
+    REQUIRE(stats.evictions == 3);
+    REQUIRE(stats.capacity == 0);
+
+    pool.release(pool.acquire(test_file));
+    REQUIRE(pool.stats().idle == 0);
+  }
+
+  SECTION("test invalidation on mount changes")
+  {
+    physfs::handle_pool pool;
+
+    auto lent = pool.acquire(test_file);
+    pool.release(pool.acquire(other_file));
+    REQUIRE(pool.stats().idle == 1);
+
+    physfs::mount(TEST_DATA, std::string("test_data"));
+    auto reopened = pool.acquire(other_file);
+    pool.release(std::move(lent));
+
+    auto stats = pool.stats();
+    REQUIRE(stats.hits == 0);
+    REQUIRE(stats.invalidations == 1);
+    REQUIRE(stats.idle == 0);
+
+    pool.release(std::move(reopened));
+    REQUIRE(pool.stats().idle == 1);
+    pool.clear();
+    physfs::unmount(TEST_DATA);
+  }
+
+  SECTION("test concurrent access")
+  {
+    physfs::handle_pool pool(4);
+    // catch assertions aren't thread safe, the workers only count wrong results
+    std::atomic<int> failures(0);
+    auto work = [&]() {
+      char buffer[32];
+      for (int i = 0; i < 100; ++i)
+      {
+        try
+        {
+          auto device = pool.acquire((i % 2 == 0) ? test_file : other_file);
+          if (device.read(buffer, 4) != 4)
+          {
+            ++failures;
+          }
+          pool.release(std::move(device));
+        }
+        catch (...)
+        {
+          ++failures;
+        }
+      }
+    };
+
+    std::thread first(work);
+    std::thread second(work);
+    work();
+    first.join();
+    second.join();
+
+    REQUIRE(failures == 0);
+    const auto stats = pool.stats();
+    REQUIRE(stats.hits + stats.misses == 300);
+    REQUIRE(stats.idle <= 4);
+    pool.clear();
+  }
+
+  physfs::unmount(target_archive);
+}
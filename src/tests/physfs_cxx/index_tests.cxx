@@ -0,0 +1,98 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+TEST_CASE("testing the virtual file tree index for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  physfs::mount(target_archive, archiv_mount_point);
+
+  SECTION("test streaming enumeration")
+  {
+    std::size_t count = 0;
+    physfs::enumerate(archiv_mount_point, [&count](const char*) {
+      ++count;
+      return true;
+    });
+    REQUIRE(count == 6);
+
+    count = 0;
+    physfs::enumerate(archiv_mount_point, [&count](const char*) {
+      ++count;
+      return false;
+    });
+    REQUIRE(count == 1);
+
+    REQUIRE_THROWS_AS(physfs::enumerate(archiv_mount_point, [](const char*) -> bool { throw std::runtime_error("stop"); }), std::runtime_error);
+  }
+
+  SECTION("test queries through the index")
+  {
+    physfs::vfs_index index;
+
+    REQUIRE(index.exists(archiv_mount_point + "/themeinfo.txt"));
+    REQUIRE(index.exists("/" + archiv_mount_point + "/wallpapers/"));
+    REQUIRE(index.exists(archiv_mount_point + "//themeinfo.txt"));
+    REQUIRE(index.is_directory("//" + archiv_mount_point + "//wallpapers//"));
+    REQUIRE(index.exists(archiv_mount_point + "//themeinfo.txt") == physfs::exists(archiv_mount_point + "//themeinfo.txt"));
+    REQUIRE_THROWS_AS(index.exists(archiv_mount_point + "/../themeinfo.txt"), physfs::exception);
+    REQUIRE_THROWS_AS(index.stat(archiv_mount_point + "/./themeinfo.txt"), physfs::exception);
+    REQUIRE_FALSE(index.exists(archiv_mount_point + "/missing.txt"));
+    REQUIRE_FALSE(index.exists("missing/directory/file.txt"));
+
+    REQUIRE(index.stat(archiv_mount_point + "/themeinfo.txt").size() == 19);
+    REQUIRE(index.is_regular_file(archiv_mount_point + "/themeinfo.txt"));
+    REQUIRE(index.is_directory(archiv_mount_point + "/wallpapers"));
+    REQUIRE_THROWS_AS(index.stat(archiv_mount_point + "/missing.txt"), physfs::exception);
+
+    REQUIRE_THAT(index.real_dir(archiv_mount_point + "/themeinfo.txt"), Catch::Matchers::StartsWith(TEST_DATA));
+
+    auto files = index.enumerate_files(archiv_mount_point);
+    REQUIRE(files.size() == 6);
+    REQUIRE(std::find(files.begin(), files.end(), "themeinfo.txt") != files.end());
+    REQUIRE(index.enumerate_files(archiv_mount_point + "/wallpapers").size() == physfs::enumerate_files(archiv_mount_point + "/wallpapers").size());
+
+    const auto cached = index.size();
+    REQUIRE(index.exists(archiv_mount_point + "/fakebar.png"));
+    REQUIRE(index.size() == cached);
+  }
+
+  SECTION("test invalidation of the index")
+  {
+    physfs::vfs_index index;
+    const std::string data_mount_point("test_data");
+    const std::string test_file("index_test_file.txt");
+
+    REQUIRE_FALSE(index.exists(data_mount_point + "/avatar.jpg"));
+
+    auto generation = physfs::vfs_generation();
+    physfs::mount(TEST_DATA, data_mount_point);
+    REQUIRE(physfs::vfs_generation() != generation);
+    REQUIRE(index.exists(data_mount_point + "/avatar.jpg"));
+
+    physfs::set_write_dir(TEST_DATA);
+    if (physfs::exists(test_file))
+    {
+      physfs::remove(test_file);
+    }
+    REQUIRE_FALSE(index.exists(data_mount_point + "/" + test_file));
+
+    {
+      physfs::ofstream outfile(test_file);
+      outfile << "index";
+    }
+    REQUIRE(index.exists(data_mount_point + "/" + test_file));
+    REQUIRE(index.stat(data_mount_point + "/" + test_file).size() == 5);
+
+    physfs::remove(test_file);
+    REQUIRE_FALSE(index.exists(data_mount_point + "/" + test_file));
+
+    physfs::unmount(TEST_DATA);
+    REQUIRE_FALSE(index.exists(data_mount_point + "/avatar.jpg"));
+  }
+
+  physfs::unmount(target_archive);
+}
@@ -0,0 +1,129 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+using physfs::io_operation;
+
+TEST_CASE("testing the io instrumentation for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  const std::string test_file(archiv_mount_point + "/themeinfo.txt");
+  physfs::mount(target_archive, archiv_mount_point);
+  physfs::reset_io_stats();
+
+  SECTION("test recording of file operations")
+  {
+    {
+      physfs::file_device device(test_file, physfs::access_mode::read);
+      char buffer[10];
+      REQUIRE(device.read(buffer, 10) == 10);
+      device.seek(2);
+      REQUIRE(device.read(buffer, 4) == 4);
+      device.seek(12);
+      REQUIRE(device.tell() == 12);
+    }
+
+    const auto snapshot = physfs::snapshot_io_stats();
+    if (!physfs::instrumentation_enabled)
+    {
+      REQUIRE(snapshot.files.empty());
+      REQUIRE(snapshot.total[io_operation::read].calls == 0);
+      return;
+    }
+
+    const auto& file = snapshot.files.at(test_file);
+    REQUIRE(file[io_operation::open].calls == 1);
+    REQUIRE(file[io_operation::read].calls == 2);
+    REQUIRE(file[io_operation::read].bytes == 14);
+    REQUIRE(file[io_operation::seek].calls == 2);
+    REQUIRE(file[io_operation::tell].calls == 1);
+    REQUIRE(file[io_operation::close].calls == 1);
+    // seek directions are only recorded by mount
+    REQUIRE(file.backward_seeks == 0);
+
+    const auto& read = file[io_operation::read];
+    std::uint64_t bucketed = 0;
+    for (auto count : read.latency)
+    {
+      bucketed += count;
+    }
+    REQUIRE(bucketed == read.calls);
+    REQUIRE(read.percentile_ns(0.5) <= read.max_ns);
+
+    const auto& archive = snapshot.mounts.at(target_archive);
+    REQUIRE(archive[io_operation::read].bytes == 14);
+    REQUIRE(archive.forward_seeks == 1);
+    REQUIRE(archive.backward_seeks == 1);
+    REQUIRE(archive.backward_seek_bytes == 8);
+    REQUIRE(snapshot.total[io_operation::read].bytes == 14);
+    REQUIRE(snapshot.total.backward_seeks == 1);
+  }
+
+  SECTION("test recording of core calls")
+  {
+    physfs::mount(TEST_DATA, std::string("test_data"));
+    physfs::unmount(TEST_DATA);
+    REQUIRE(physfs::get_file_stat(test_file).size() == 19);
+    REQUIRE(physfs::enumerate_files(archiv_mount_point).size() == 6);
+    REQUIRE_THROWS_AS(physfs::get_file_stat(archiv_mount_point + "/missing.txt"), physfs::exception);
+    REQUIRE_THROWS_AS(physfs::file_device(archiv_mount_point + "/missing.txt", physfs::access_mode::read), physfs::exception);
+
+    const auto snapshot = physfs::snapshot_io_stats();
+    if (!physfs::instrumentation_enabled)
+    {
+      REQUIRE(snapshot.mounts.empty());
+      return;
+    }
+
+    REQUIRE(snapshot.mounts.at(TEST_DATA)[io_operation::mount].calls == 1);
+    REQUIRE(snapshot.mounts.at(TEST_DATA)[io_operation::unmount].calls == 1);
+    REQUIRE(snapshot.files.at(test_file)[io_operation::stat].calls == 1);
+    REQUIRE(snapshot.files.at(archiv_mount_point)[io_operation::enumerate].calls == 1);
+    REQUIRE(snapshot.mounts.at(target_archive)[io_operation::stat].calls == 0);
+
+    // failed lookups are only recorded in the total
+    REQUIRE(snapshot.files.count(archiv_mount_point + "/missing.txt") == 0);
+    REQUIRE(snapshot.total[io_operation::stat].errors == 1);
+    REQUIRE(snapshot.total[io_operation::open].errors == 1);
+  }
+
+  SECTION("test snapshot and reset")
+  {
+    REQUIRE(physfs::read_all(test_file).size() == 19);
+
+    const auto first = physfs::snapshot_io_stats(true);
+    const auto second = physfs::snapshot_io_stats();
+    if (physfs::instrumentation_enabled)
+    {
+      REQUIRE(first.files.at(test_file)[io_operation::read].bytes == 19);
+      // the reset removed the counters of the closed file
+      REQUIRE(second.files.count(test_file) == 0);
+      REQUIRE(second.mounts.count(target_archive) == 1);
+      REQUIRE(second.total[io_operation::open].calls == 0);
+    }
+    else
+    {
+      REQUIRE(first.files.empty());
+    }
+  }
+
+  SECTION("test reset keeps the counters of open files")
+  {
+    physfs::file_device device(test_file, physfs::access_mode::read);
+    char buffer[4];
+    REQUIRE(device.read(buffer, 4) == 4);
+    physfs::reset_io_stats();
+    REQUIRE(device.read(buffer, 4) == 4);
+
+    const auto snapshot = physfs::snapshot_io_stats();
+    if (physfs::instrumentation_enabled)
+    {
+      REQUIRE(snapshot.files.at(test_file)[io_operation::read].bytes == 4);
+    }
+  }
+
+  physfs::unmount(target_archive);
+}
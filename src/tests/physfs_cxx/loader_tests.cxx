@@ -0,0 +1,154 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+  /// occupies the single worker of a loader until release() is called
+  class blocker
+  {
+  public:
+    blocker() : m_started(std::make_shared<std::promise<void>>()), m_released(), m_signal(m_released.get_future().share()) {}
+
+    inline physfs::loader::completion_handler handler() const
+    {
+      auto started = m_started;
+      auto signal = m_signal;
+      return [started, signal](const std::string&, physfs::blob, std::exception_ptr) {
+        started->set_value();
+        signal.wait();
+      };
+    }
+
+    inline void wait_started() { m_started->get_future().wait(); }
+    inline void release() { m_released.set_value(); }
+
+  private:
+    std::shared_ptr<std::promise<void>> m_started;
+    std::promise<void> m_released;
+    std::shared_future<void> m_signal;
+  };
+} // namespace
+
+TEST_CASE("testing batch loading for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  physfs::mount(target_archive, archiv_mount_point);
+
+  const std::vector<std::string> files{archiv_mount_point + "/themeinfo.txt",
+                                       archiv_mount_point + "/backdrop.jpg",
+                                       archiv_mount_point + "/fakebar.png",
+                                       archiv_mount_point + "/wallpapers/wagic1.jpg",
+                                       archiv_mount_point + "/counters/quest.png"};
+
+  SECTION("test loading with futures")
+  {
+    physfs::loader loader(3);
+    REQUIRE(loader.thread_count() == 3);
+
+    auto results = loader.load(files);
+    REQUIRE(results.size() == files.size());
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+      auto data = results[i].get();
+      auto expected = physfs::read_all(files[i]);
+      REQUIRE(std::equal(data.begin(), data.end(), expected.begin()));
+      REQUIRE(data.size() == expected.size());
+    }
+    loader.wait();
+    REQUIRE(loader.bytes_in_flight() == 0);
+  }
+
+  SECTION("test loading of missing files")
+  {
+    physfs::loader loader(2);
+    auto result = loader.load(archiv_mount_point + "/missing.txt");
+    REQUIRE_THROWS_AS(result.get(), physfs::exception);
+  }
+
+  SECTION("test bounded memory in flight")
+  {
+    // the budget is smaller than every file, so they are loaded one after another
+    physfs::loader loader(4, 16);
+    auto results = loader.load(files);
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+      REQUIRE(results[i].get().size() == static_cast<std::size_t>(physfs::get_file_size(files[i])));
+    }
+  }
+
+  SECTION("test the budget covers running completion handlers")
+  {
+    physfs::loader loader(1);
+    blocker block;
+    loader.load(files[0], block.handler());
+    block.wait_started();
+    REQUIRE(loader.bytes_in_flight() == static_cast<std::uint64_t>(physfs::get_file_size(files[0])));
+
+    block.release();
+    loader.wait();
+    REQUIRE(loader.bytes_in_flight() == 0);
+  }
+
+  SECTION("test priority ordering and callbacks")
+  {
+    physfs::loader loader(1);
+    blocker block;
+    loader.load(files[0], block.handler());
+    block.wait_started();
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](const std::string& path, physfs::blob data, std::exception_ptr error) {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back((error || data.empty()) ? "failed" : path);
+    };
+
+    loader.load(files[1], record, -1);
+    loader.load(files[2], record, 5);
+    loader.load(files[3], record, 0);
+    loader.load(files[4], record, 5);
+
+    block.release();
+    loader.wait();
+
+    REQUIRE(order.size() == 4);
+    REQUIRE(order[0] == files[2]);
+    REQUIRE(order[1] == files[4]);
+    REQUIRE(order[2] == files[3]);
+    REQUIRE(order[3] == files[1]);
+  }
+
+  SECTION("test cancellation of pending requests")
+  {
+    physfs::loader loader(1);
+    blocker block;
+    loader.load(files[0], block.handler());
+    block.wait_started();
+
+    auto kept = loader.load(files[1]);
+    auto cancelled = loader.load(files[2]);
+    std::thread::id cancelled_on;
+    loader.load(files[3], [&cancelled_on](const std::string&, physfs::blob, std::exception_ptr) { cancelled_on = std::this_thread::get_id(); });
+    REQUIRE(loader.pending() == 3);
+
+    // cancelled requests complete on the cancelling thread
+    REQUIRE(loader.cancel(files[3]) == 1);
+    REQUIRE(cancelled_on == std::this_thread::get_id());
+    REQUIRE(loader.cancel(files[2]) == 1);
+    REQUIRE(loader.cancel(files[2]) == 0);
+    REQUIRE_THROWS_AS(cancelled.get(), physfs::exception);
+
+    block.release();
+    REQUIRE(kept.get().size() == static_cast<std::size_t>(physfs::get_file_size(files[1])));
+  }
+
+  physfs::unmount(target_archive);
+}
@@ -0,0 +1,233 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <catch.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+  void require_same_tree(const std::string& expected, const std::string& actual)
+  {
+    auto expected_files = physfs::enumerate_files(expected);
+    auto actual_files = physfs::enumerate_files(actual);
+    std::sort(expected_files.begin(), expected_files.end());
+    std::sort(actual_files.begin(), actual_files.end());
+    REQUIRE(expected_files == actual_files);
+
+    for (const auto& name : expected_files)
+    {
+      const auto expected_stat = physfs::get_file_stat(expected + "/" + name);
+      const auto actual_stat = physfs::get_file_stat(actual + "/" + name);
+      REQUIRE(expected_stat.type() == actual_stat.type());
+      if (expected_stat.type() == physfs::filetype::directory)
+      {
+        require_same_tree(expected + "/" + name, actual + "/" + name);
+      }
+      else
+      {
+        REQUIRE(expected_stat.size() == actual_stat.size());
+        REQUIRE(physfs::read_all(expected + "/" + name) == physfs::read_all(actual + "/" + name));
+      }
+    }
+  }
+} // namespace
+
+TEST_CASE("testing the pack archiver for physfs", "[physfs]")
+{
+  physfs::init_guard guard{};
+  auto archiver = physfs::register_pack_archiver();
+
+  const std::string archiv_mount_point("zip_archiv");
+  const std::string target_archive(std::string(TEST_DATA) + "/test_archive.zip");
+  const std::string pack_mount_point("pack");
+  const std::string target_pack(std::string(TEST_DATA) + "/test_pack.pxp");
+  physfs::mount(target_archive, archiv_mount_point);
+
+  std::ostringstream numbers;
+  for (int i = 0; i < 2000; ++i)
+  {
+    numbers << i << (i % 10 == 9 ? '\n' : ' ');
+  }
+  const std::string generated(numbers.str());
+  char* storage = nullptr;
+  const auto generated_blob = physfs::blob::allocate(generated.size(), storage);
+  std::memcpy(storage, generated.data(), generated.size());
+
+  {
+    // small blocks to get several of them per file
+    physfs::pack_writer writer(physfs::pack_writer::default_compression, 1024);
+    writer.add_tree(archiv_mount_point);
+    writer.add_file("generated/numbers.txt", generated_blob);
+    writer.add_directory("empty");
+
+    REQUIRE_THROWS_AS(writer.add_file("../outside.txt", physfs::blob()), physfs::exception);
+    REQUIRE_THROWS_AS(writer.add_file("generated", physfs::blob()), physfs::exception);
+    REQUIRE_THROWS_AS(writer.add_directory("generated/numbers.txt"), physfs::exception);
+
+    std::ofstream out(target_pack, std::ios::binary | std::ios::trunc);
+    writer.write(out);
+  }
+  physfs::mount(target_pack, pack_mount_point);
+
+  SECTION("test content against the zip archive")
+  {
+    REQUIRE(physfs::enumerate_files(pack_mount_point).size() == 8);
+    REQUIRE(physfs::is_directory(pack_mount_point + "/empty"));
+    REQUIRE(physfs::enumerate_files(pack_mount_point + "/empty").empty());
+    REQUIRE(physfs::get_file_size(pack_mount_point + "/themeinfo.txt") == 19);
+    REQUIRE(physfs::is_readonly(pack_mount_point + "/themeinfo.txt"));
+    REQUIRE_FALSE(physfs::exists(pack_mount_point + "/missing.txt"));
+    REQUIRE_THROWS_AS(physfs::file_device(pack_mount_point + "/wallpapers", physfs::access_mode::read), physfs::exception);
+
+    for (const auto& name : physfs::enumerate_files(archiv_mount_point))
+    {
+      if (physfs::is_directory(archiv_mount_point + "/" + name))
+      {
+        require_same_tree(archiv_mount_point + "/" + name, pack_mount_point + "/" + name);
+      }
+      else
+      {
+        REQUIRE(physfs::read_all(archiv_mount_point + "/" + name) == physfs::read_all(pack_mount_point + "/" + name));
+      }
+    }
+  }
+
+  SECTION("test random access in block compressed files")
+  {
+    const std::string filename(pack_mount_point + "/generated/numbers.txt");
+    REQUIRE(physfs::read_all<std::string>(filename) == generated);
+
+    physfs::file_device device(filename, physfs::access_mode::read);
+    char buffer[1500];
+    const std::uint64_t offsets[] = {5000, 100, 1023, 1024, 2047, 7000, 0};
+    for (auto offset : offsets)
+    {
+      device.seek(offset);
+      const auto count = device.read(buffer, sizeof(buffer));
+      REQUIRE(count == static_cast<std::int64_t>(std::min<std::uint64_t>(sizeof(buffer), generated.size() - offset)));
+      REQUIRE(std::string(buffer, static_cast<std::size_t>(count)) == generated.substr(offset, static_cast<std::size_t>(count)));
+    }
+
+    device.seek(generated.size());
+    REQUIRE(device.read(buffer, sizeof(buffer)) == 0);
+  }
+
+  SECTION("test zero copy reads")
+  {
+    const std::string filename(pack_mount_point + "/themeinfo.txt");
+    const auto mapped = physfs::read_all_mapped(filename);
+    REQUIRE(std::string(mapped.data(), mapped.size()) == physfs::read_all<std::string>(filename));
+#ifdef PHYSFS_CXX_PACK_MMAP
+    REQUIRE(reinterpret_cast<std::uintptr_t>(mapped.data()) % physfs::pack_writer::default_alignment == 0);
+#endif
+
+    // the mapping outlives the mount
+    physfs::unmount(target_pack);
+    REQUIRE(std::string(mapped.data(), mapped.size()) == "Ilya Baranovsky\r\n\r\n");
+    physfs::mount(target_pack, pack_mount_point);
+
+    REQUIRE(physfs::read_all_mapped(archiv_mount_point + "/themeinfo.txt").size() == 19);
+    REQUIRE(physfs::read_all_mapped(pack_mount_point + "/generated/numbers.txt").size() == generated.size());
+  }
+
+  SECTION("test packs mounted from memory")
+  {
+    auto build = [](const std::string& content) {
+      physfs::pack_writer writer(0);
+      char* storage = nullptr;
+      const auto data = physfs::blob::allocate(content.size(), storage);
+      std::memcpy(storage, content.data(), content.size());
+      writer.add_file("content.txt", data, 0);
+
+      std::ostringstream out;
+      writer.write(out);
+      return out.str();
+    };
+
+    // a pack with the same layout and name on disk must not be mapped in place of the mounted bytes
+    const std::string pack_name("same_layout.pxp");
+    {
+      const std::string disk_pack(build("read from disk!!"));
+      std::ofstream out(pack_name, std::ios::binary | std::ios::trunc);
+      out.write(disk_pack.data(), static_cast<std::streamsize>(disk_pack.size()));
+    }
+
+    const std::string memory_pack(build("read from memory"));
+    char* storage = nullptr;
+    const auto memory_blob = physfs::blob::allocate(memory_pack.size(), storage);
+    std::memcpy(storage, memory_pack.data(), memory_pack.size());
+    {
+      auto memory_guard = physfs::mount_memory(memory_blob, pack_name, std::string("memory_pack"));
+      REQUIRE(physfs::read_all<std::string>("memory_pack/content.txt") == "read from memory");
+      const auto mapped = physfs::read_all_mapped("memory_pack/content.txt");
+      REQUIRE(std::string(mapped.data(), mapped.size()) == "read from memory");
+    }
+    std::remove(pack_name.c_str());
+  }
+
+  SECTION("test writing packs behind other data")
+  {
+    physfs::pack_writer writer(0);
+    char* storage = nullptr;
+    const auto data = physfs::blob::allocate(7, storage);
+    std::memcpy(storage, "payload", 7);
+    writer.add_file("content.txt", data, 0);
+
+    // the pack starts at the current position and keeps the data in front of it
+    const std::string prefix("prefix data");
+    std::ostringstream out;
+    out << prefix;
+    writer.write(out);
+    const std::string written(out.str());
+    REQUIRE(written.compare(0, prefix.size(), prefix) == 0);
+
+    const std::string pack(written.substr(prefix.size()));
+    char* pack_storage = nullptr;
+    const auto pack_blob = physfs::blob::allocate(pack.size(), pack_storage);
+    std::memcpy(pack_storage, pack.data(), pack.size());
+    {
+      auto memory_guard = physfs::mount_memory(pack_blob, "behind.pxp", std::string("behind_pack"));
+      REQUIRE(physfs::read_all<std::string>("behind_pack/content.txt") == "payload");
+    }
+
+    // files in append mode add every write at the end
+    const std::string appended_pack("appended.pxp");
+    {
+      std::ofstream appended(appended_pack, std::ios::binary | std::ios::trunc);
+      appended << prefix;
+    }
+    {
+      std::ofstream appended(appended_pack, std::ios::binary | std::ios::app);
+      REQUIRE_THROWS_AS(writer.write(appended), physfs::exception);
+    }
+    std::remove(appended_pack.c_str());
+  }
+
+  SECTION("test damaged packs and the archiver registration")
+  {
+    const std::string broken_pack(std::string(TEST_DATA) + "/broken_pack.pxp");
+    {
+      std::ifstream in(target_pack, std::ios::binary);
+      std::vector<char> head(100);
+      in.read(head.data(), static_cast<std::streamsize>(head.size()));
+      std::ofstream out(broken_pack, std::ios::binary | std::ios::trunc);
+      out.write(head.data(), static_cast<std::streamsize>(head.size()));
+    }
+    REQUIRE_THROWS_AS(physfs::mount(broken_pack, std::string("broken")), physfs::exception);
+    std::remove(broken_pack.c_str());
+
+    REQUIRE_THROWS_AS(physfs::register_pack_archiver(), physfs::exception);
+    REQUIRE_THROWS_AS(archiver.deregister(), physfs::exception);
+  }
+
+  physfs::unmount(target_pack);
+  physfs::unmount(target_archive);
+
+  archiver.deregister();
+  REQUIRE_FALSE(archiver.is_registered());
+  REQUIRE_THROWS_AS(physfs::mount(target_pack, pack_mount_point), physfs::exception);
+  std::remove(target_pack.c_str());
+}
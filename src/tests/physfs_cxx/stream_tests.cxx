@@ -3,6 +3,15 @@
 
 #include <catch.hpp>
 
+#include <vector>
+
+/// exposes the device to replace it under the background writer
+struct device_streambuf : public physfs::fstreambuf
+{
+  device_streambuf(const std::string& filename, physfs::access_mode mode, std::size_t buffer_size) : physfs::fstreambuf(filename, mode, buffer_size) {}
+  using physfs::fstreambuf::device;
+};
+
 std::size_t length(physfs::ifstream& file)
 {
   auto pos = file.tellg();
@@ -53,6 +62,89 @@ TEST_CASE("testing stream access for physfs", "[physfs]")
     REQUIRE_THAT(line_content[0], Catch::Matchers::StartsWith("Ilya Baranovsky"));
   }
 
+  SECTION("test reading with different buffer sizes")
+  {
+    const std::string wallpaper_file(archiv_mount_point + "/wallpapers/wagic1.jpg");
+
+    std::vector<char> expected;
+    {
+      physfs::file_device device(wallpaper_file, physfs::access_mode::read);
+      expected.resize(static_cast<std::size_t>(device.file_length()));
+      REQUIRE(device.read(expected.data(), expected.size()) == static_cast<std::int64_t>(expected.size()));
+    }
+
+    const std::size_t buffer_sizes[] = {physfs::fstreambuf::min_buffer_size, 64, physfs::fstreambuf::default_buffer_size, 1024 * 1024};
+    for (auto buffer_size : buffer_sizes)
+    {
+      physfs::ifstream infile(wallpaper_file, physfs::access_mode::read, buffer_size);
+      REQUIRE(infile.rdbuf()->buffer_size() == buffer_size);
+
+      // alternate between reads smaller and larger than the buffer
+      std::vector<char> content(expected.size());
+      std::size_t offset = 0;
+      std::size_t chunk = 7;
+      while (offset < content.size())
+      {
+        const std::size_t count = std::min(chunk, content.size() - offset);
+        infile.read(content.data() + offset, count);
+        REQUIRE(static_cast<std::size_t>(infile.gcount()) == count);
+        offset += count;
+        chunk = (chunk < 4096) ? chunk * 9 : 7;
+      }
+
+      REQUIRE(content == expected);
+      REQUIRE(infile.get() == std::char_traits<char>::eof());
+    }
+  }
+
+  SECTION("test seeking inside the read buffer")
+  {
+    const std::string theme_info_file(archiv_mount_point + "/themeinfo.txt");
+    physfs::ifstream infile(theme_info_file);
+
+    std::string word;
+    infile >> word;
+    REQUIRE_THAT(word, Catch::Matchers::Equals("Ilya"));
+    REQUIRE(infile.tellg() == 4);
+
+    infile.seekg(0);
+    REQUIRE(infile.peek() == 'I');
+
+    infile.seekg(5, std::ios::cur);
+    REQUIRE(infile.tellg() == 5);
+    infile >> word;
+    REQUIRE_THAT(word, Catch::Matchers::StartsWith("Baranovsky"));
+
+    infile.seekg(-static_cast<int>(word.size()), std::ios::cur);
+    REQUIRE(infile.tellg() == 5);
+
+    infile.rdbuf()->pubsetbuf(nullptr, 4);
+    REQUIRE(infile.rdbuf()->buffer_size() == 4);
+    REQUIRE(infile.tellg() == 5);
+    infile >> word;
+    REQUIRE_THAT(word, Catch::Matchers::StartsWith("Baranovsky"));
+  }
+
+  SECTION("test writing to streams without output")
+  {
+    const std::string test_file(archiv_mount_point + "/themeinfo.txt");
+
+    physfs::fstream read_stream(test_file, physfs::access_mode::read);
+    read_stream << "x";
+    REQUIRE(read_stream.bad());
+
+    physfs::fstream single_char(test_file, physfs::access_mode::read);
+    single_char.put('x');
+    REQUIRE(single_char.bad());
+
+    physfs::ifstream cached(test_file, physfs::read_all_shared(test_file));
+    REQUIRE(cached.rdbuf()->sputn("xyz", 3) == 0);
+
+    physfs::ofstream unopened;
+    unopened << std::string(64 * 1024, 'x');
+    REQUIRE(unopened.bad());
+  }
+
   SECTION("test writing of files")
   {
     physfs::set_write_dir(TEST_DATA);
@@ -116,4 +208,143 @@ TEST_CASE("testing stream access for physfs", "[physfs]")
     }
     physfs::remove(test_file);
   }
-}
\ No newline at end of file
+
+  SECTION("test moving streams")
+  {
+    const std::string test_file(archiv_mount_point + "/themeinfo.txt");
+
+    physfs::ifstream infile(test_file);
+    std::string word;
+    infile >> word;
+    REQUIRE_THAT(word, Catch::Matchers::Equals("Ilya"));
+
+    physfs::ifstream moved(std::move(infile));
+    REQUIRE_FALSE(infile.is_open());
+    REQUIRE(moved.is_open());
+    REQUIRE(moved.filename() == test_file);
+    moved >> word;
+    REQUIRE_THAT(word, Catch::Matchers::Equals("Baranovsky"));
+
+    std::vector<physfs::ifstream> streams;
+    streams.push_back(std::move(moved));
+    streams.emplace_back(test_file);
+    streams[1] >> word;
+    REQUIRE_THAT(word, Catch::Matchers::Equals("Ilya"));
+
+    streams[0] = std::move(streams[1]);
+    streams[0] >> word;
+    REQUIRE_THAT(word, Catch::Matchers::Equals("Baranovsky"));
+    REQUIRE_FALSE(streams[1].is_open());
+
+    physfs::file_device device(test_file, physfs::access_mode::read);
+    physfs::file_device other(std::move(device));
+    REQUIRE_FALSE(device.is_open());
+    REQUIRE(other.file_length() == 19);
+    device = std::move(other);
+    REQUIRE(device.is_open());
+    REQUIRE(device.filename() == test_file);
+  }
+
+  SECTION("test write behind")
+  {
+    physfs::set_write_dir(TEST_DATA);
+    const std::string test_file("test_file_write_behind.txt");
+    const int repeations = 1000;
+
+    if (physfs::exists(test_file))
+    {
+      physfs::remove(test_file);
+    }
+
+    std::string expected;
+    {
+      physfs::ofstream outfile;
+      outfile.set_write_behind(2);
+      REQUIRE(outfile.is_write_behind());
+      outfile.rdbuf()->pubsetbuf(nullptr, 16);
+      outfile.open(test_file);
+
+      for (int i = 0; i < repeations / 2; ++i)
+      {
+        outfile << i << "\n";
+        expected += std::to_string(i) + "\n";
+      }
+      outfile.flush();
+      REQUIRE(outfile.good());
+      REQUIRE(physfs::file_device(test_file, physfs::access_mode::read).file_length() == static_cast<std::int64_t>(expected.size()));
+
+      physfs::ofstream moved(std::move(outfile));
+      REQUIRE(moved.is_write_behind());
+      for (int i = repeations / 2; i < repeations; ++i)
+      {
+        moved << i << "\n";
+        expected += std::to_string(i) + "\n";
+      }
+      REQUIRE(moved.tellp() == static_cast<std::streamoff>(expected.size()));
+
+      moved.set_write_behind(0);
+      moved << "end\n";
+      expected += "end\n";
+      moved.close();
+      REQUIRE(moved.good());
+    }
+
+    REQUIRE(physfs::read_all<std::string>(test_file) == expected);
+    physfs::remove(test_file);
+  }
+
+  SECTION("test write errors in write behind mode")
+  {
+    physfs::set_write_dir(TEST_DATA);
+    const std::string test_file("test_file_write_behind_error.txt");
+    const std::string read_only_file(archiv_mount_point + "/themeinfo.txt");
+
+    if (physfs::exists(test_file))
+    {
+      physfs::remove(test_file);
+    }
+
+    device_streambuf buffer(test_file, physfs::access_mode::write, 16);
+    buffer.set_write_behind(2);
+    std::ostream out(&buffer);
+    out << "first\n";
+    out.flush();
+    REQUIRE(out.good());
+
+    // the writer fails on a read only device
+    buffer.device() = physfs::file_device(read_only_file, physfs::access_mode::read);
+    out << std::string(100, 'x');
+    out.flush();
+    REQUIRE(out.bad());
+
+    // nothing is written after the first error, even if the device works again
+    buffer.device() = physfs::file_device(test_file, physfs::access_mode::append);
+    out.clear();
+    out << "second\n";
+    out.flush();
+    REQUIRE(out.bad());
+    REQUIRE_THROWS_AS(buffer.close(), physfs::exception);
+    REQUIRE_FALSE(buffer.is_open());
+
+    REQUIRE(physfs::read_all<std::string>(test_file) == "first\n");
+    physfs::remove(test_file);
+  }
+
+  SECTION("test pending output errors when changing buffers")
+  {
+    physfs::set_write_dir(TEST_DATA);
+    const std::string test_file("test_file_pending_error.txt");
+
+    device_streambuf buffer(test_file, physfs::access_mode::write, 16);
+    std::ostream out(&buffer);
+    out << "pending";
+
+    // the buffered output can't be written to a read only device
+    const std::string read_only_file(archiv_mount_point + "/themeinfo.txt");
+    buffer.device() = physfs::file_device(read_only_file, physfs::access_mode::read);
+    REQUIRE_THROWS_WITH(buffer.set_device_buffer(0), Catch::Matchers::Contains("couldn't write pending output of \"" + read_only_file + "\""));
+    REQUIRE_THROWS_WITH(buffer.set_write_behind(), Catch::Matchers::Contains("couldn't write pending output"));
+    REQUIRE(buffer.close() == nullptr);
+    physfs::remove(test_file);
+  }
+}
@@ -0,0 +1,95 @@
+#include <physfs_cxx/physfs.hxx>
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+  void print_usage(const char* program)
+  {
+    std::cerr << "usage: " << program << " [options] <input> <output>\n"
+              << "  builds the pack <output> from <input>, a directory or any archive physfs can mount\n"
+              << "  --level <n>           zlib compression level, 0 stores all files (default: " << physfs::pack_writer::default_compression << ")\n"
+              << "  --block-size <n>      size of the independently compressed blocks (default: " << physfs::pack_writer::default_block_size << ")\n"
+              << "  --alignment <n>       alignment of stored files, a power of two (default: " << physfs::pack_writer::default_alignment << ")\n";
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int level = physfs::pack_writer::default_compression;
+  std::uint32_t block_size = physfs::pack_writer::default_block_size;
+  std::uint32_t alignment = physfs::pack_writer::default_alignment;
+  std::vector<std::string> arguments;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool has_value = (i + 1 < argc);
+    if (std::strcmp(argv[i], "--level") == 0 && has_value)
+    {
+      level = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--block-size") == 0 && has_value)
+    {
+      block_size = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (std::strcmp(argv[i], "--alignment") == 0 && has_value)
+    {
+      alignment = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (argv[i][0] == '-')
+    {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    else
+    {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  if (arguments.size() != 2)
+  {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    physfs::init_guard guard(argv[0]);
+    const auto archiver = physfs::register_pack_archiver();
+
+    const std::string input("input");
+    physfs::mount(arguments[0], input);
+
+    physfs::pack_writer writer(level, block_size, alignment);
+    writer.add_tree(input);
+
+    std::ofstream out(arguments[1], std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      std::cerr << "couldn't create \"" << arguments[1] << "\"" << std::endl;
+      return EXIT_FAILURE;
+    }
+    writer.write(out);
+    physfs::unmount(arguments[0]);
+
+    std::cout << arguments[1] << ": " << writer.size() << " entries" << std::endl;
+  }
+  catch (physfs::exception& e)
+  {
+    std::cerr << "packing failed: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (std::exception& e)
+  {
+    // e.g. std::bad_alloc for large inputs
+    std::cerr << "packing failed: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}